@@ -1,11 +1,22 @@
 #pragma once
 
+#include "Components/ActorComponent.h"
 #include "CoreMinimal.h"
 #include "Engine/TargetPoint.h"
 #include "GameFramework/SaveGame.h"
 
 #include "DataTypes.generated.h"
 
+UENUM(BlueprintType)
+enum class EInvadersCollisionMode : uint8 {
+    // Engine overlap queries for every bullet
+    Overlap,
+    // Formation grid math and bounds tests for player bullets
+    Analytic,
+    // Every hit analytic, gameplay actors are spawned without collision
+    PhysicsFree,
+};
+
 USTRUCT(BlueprintType)
 struct FGameRules {
     GENERATED_BODY()
@@ -40,6 +51,28 @@ struct FGameRules {
 
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     int LastRow = 8;
+
+    // Seed of the gameplay random stream, zero picks one at startup.
+    // Overridden by -InvadersSeed= on the command line.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    int Seed = 0;
+
+    // Simulation steps per second, independent of the frame rate
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "10"))
+    float SimRate = 120.f;
+
+    // Steps run at most per frame, time past that is dropped so a slow
+    // frame can't snowball into ever longer ones
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+    int MaxStepsPerFrame = 8;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    EInvadersCollisionMode CollisionMode = EInvadersCollisionMode::Overlap;
+
+    // Render the formation with one instanced static mesh per enemy type
+    // instead of one actor per enemy. Implies analytic player bullet hits.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    bool InstancedEnemies = false;
 };
 
 USTRUCT(BlueprintType)
@@ -47,10 +80,10 @@ struct FEnemyDef {
     GENERATED_BODY()
 
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Game)
-    TSubclassOf<AActor> ShipClass;
+    TSoftClassPtr<AActor> ShipClass;
 
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Game)
-    TSubclassOf<AActor> ShipRTClass;
+    TSoftClassPtr<AActor> ShipRTClass;
 
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     int Points = 100.f;
@@ -60,7 +93,7 @@ USTRUCT(BlueprintType)
 struct FPlayerDef {
     GENERATED_BODY()
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Game)
-    TSubclassOf<AActor> ShipClass;
+    TSoftClassPtr<AActor> ShipClass;
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     TSoftObjectPtr<ATargetPoint> SpawnPoint;
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
@@ -76,10 +109,14 @@ struct FBulletDef {
     GENERATED_BODY()
 
     UPROPERTY(EditAnywhere, BlueprintReadOnly)
-    TSubclassOf<AActor> BulletClass;
+    TSoftClassPtr<AActor> BulletClass;
 
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     float Velocity = 100.f;
+
+    // Size of the bullet pool, bullets over the limit are not fired
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+    int MaxBullets = 20;
 };
 
 USTRUCT(BlueprintType)
@@ -87,7 +124,7 @@ struct FAsteroidDef {
     GENERATED_BODY()
 
     UPROPERTY(EditAnywhere, BlueprintReadOnly)
-    TSubclassOf<AActor> AsteroidClass;
+    TSoftClassPtr<AActor> AsteroidClass;
 
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     TSoftObjectPtr<ATargetPoint> SpawnPoint;
@@ -99,29 +136,73 @@ struct FAsteroidDef {
     int Health = 5;
 };
 
+// Identifies the simulation unit an actor mirrors, see MakeEntityId
+UCLASS()
+class INVADERS_API UInvadersEntityComponent : public UActorComponent {
+    GENERATED_BODY()
+   public:
+    UPROPERTY(VisibleAnywhere, Category = Game)
+    uint32 EntityId = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FInvadersScoreEntry {
+    GENERATED_BODY()
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    int32 Score = 0;
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    int32 Level = 0;
+    // Simulated seconds, pauses not included
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    float Duration = 0.f;
+    // Gameplay stream seed the session was played with
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    int32 Seed = 0;
+};
+
 UCLASS()
 class INVADERS_API UInvadersSaveGame : public USaveGame {
     GENERATED_BODY()
    public:
+    // Version 0 saves only have HiScore
+    static constexpr int32 LatestVersion = 1;
+    static constexpr int MaxScores = 10;
+
+    UPROPERTY(VisibleAnywhere, Category = Basic)
+    int32 Version = 0;
+
     UPROPERTY(VisibleAnywhere, Category = Basic)
     uint32 HiScore;
-};
 
-// Lightweight game state;
-struct FInvadersGameState {
-    bool LevelStarted;
-    float EnemyProgTime;
-    float EnemyAppearAnimTime;
-    float PlayerAppearAnimTime;
-    float UfoProgTime;
-    int TotalEnemyNum;
-    int ActiveEnemyNum;
-    int ActiveEnemyBullets;
-    int ActivePlayerBullets;
-    int CurrentLevel;
-    int CurrentLives;
-
-    int32 Score;
-    int32 PrevHiScore;
-    int32 HiScore;
+    // Best scores first, at most MaxScores
+    UPROPERTY(VisibleAnywhere, Category = Basic)
+    TArray<FInvadersScoreEntry> Scores;
+
+    void Upgrade() {
+        if (Version < 1 && HiScore > 0) {
+            FInvadersScoreEntry Entry;
+            Entry.Score = HiScore;
+            Scores.Add(Entry);
+        }
+        Version = LatestVersion;
+    }
+
+    // Returns the rank the entry got in the table, INDEX_NONE if it
+    // didn't make it
+    int AddScore(const FInvadersScoreEntry& Entry) {
+        int Rank = 0;
+        while (Rank < Scores.Num() && Scores[Rank].Score >= Entry.Score) {
+            Rank++;
+        }
+        if (Rank >= MaxScores) {
+            return INDEX_NONE;
+        }
+        Scores.Insert(Entry, Rank);
+        if (Scores.Num() > MaxScores) {
+            Scores.SetNum(MaxScores);
+        }
+        HiScore = Scores[0].Score;
+        return Rank;
+    }
 };
@@ -1,4 +1,5 @@
 #include "DataTypes.h"
+#include "InvadersSim.h"
 
 #include "Components/Button.h"
 #include "Components/TextBlock.h"
@@ -7,18 +8,27 @@
 
 namespace GameUtils {
 
+// Menu texts, set when a menu opens and never while the game steps. The
+// patterns are compiled once, only the numbers are formatted per call.
 inline void UpdateScoreTexts(FInvadersGameState& State,
                              UTextBlock* HiScoreText,
                              UTextBlock* CurScoreText = nullptr) {
-    FString HiScoreStr = "hiscore: " + FString::FromInt(State.PrevHiScore);
-    HiScoreText->SetText(FText::FromString(HiScoreStr));
+    static const FTextFormat HiScoreFormat =
+        NSLOCTEXT("Invaders", "HiScore", "hiscore: {0}");
+    static const FTextFormat ScoreFormat =
+        NSLOCTEXT("Invaders", "Score", "score: {0}");
+    static const FTextFormat NewHiScoreFormat =
+        NSLOCTEXT("Invaders", "NewHiScore", "score: {0} // new hiscore //");
+    const FNumberFormattingOptions& Digits =
+        FNumberFormattingOptions::DefaultNoGrouping();
+
+    HiScoreText->SetText(FText::Format(
+        HiScoreFormat, FText::AsNumber(State.PrevHiScore, &Digits)));
 
     if (CurScoreText) {
-        FString CurScoreStr = "score: " + FString::FromInt(State.Score);
-        if (State.Score > State.PrevHiScore) {
-            CurScoreStr.Append(" // new hiscore //");
-        }
-        CurScoreText->SetText(FText::FromString(CurScoreStr));
+        CurScoreText->SetText(FText::Format(
+            State.Score > State.PrevHiScore ? NewHiScoreFormat : ScoreFormat,
+            FText::AsNumber(State.Score, &Digits)));
     }
 }
 
@@ -0,0 +1,72 @@
+#include "InvadersActorSync.h"
+
+#include "GameFramework/Actor.h"
+
+void FInvadersActorSync::Reset() {
+    Actors.Reset();
+    Locations.Reset();
+    Visible.Reset();
+    Dirty.Reset();
+    DirtyIdx.Reset();
+}
+
+int FInvadersActorSync::Add(AActor* Actor) {
+    check(Actor);
+    Locations.Add(Actor->GetActorLocation());
+    Visible.Add(!Actor->IsHidden());
+    Dirty.Add(0);
+    return Actors.Add(Actor);
+}
+
+void FInvadersActorSync::SetVisible(int Idx, bool InVisible) {
+    if (Visible[Idx] != InVisible) {
+        Visible[Idx] = InVisible;
+        MarkDirty(Idx, DirtyVisible);
+    }
+}
+
+void FInvadersActorSync::SetLocation(int Idx, const FVector& Location) {
+    if (Locations[Idx] == Location) {
+        return;
+    }
+    Locations[Idx] = Location;
+    if (Visible[Idx]) {
+        MarkDirty(Idx, DirtyLocation);
+    } else {
+        // Queued by the show that pushes it
+        Dirty[Idx] |= DirtyLocation;
+    }
+}
+
+void FInvadersActorSync::MarkDirty(int Idx, uint8 Bits) {
+    if (!(Dirty[Idx] & Queued)) {
+        DirtyIdx.Add(Idx);
+    }
+    Dirty[Idx] |= Bits | Queued;
+}
+
+int FInvadersActorSync::Flush() {
+    // Every queued actor has at least one property to push
+    for (int Idx : DirtyIdx) {
+        AActor* Actor = Actors[Idx];
+        uint8& Bits = Dirty[Idx];
+
+        // Moved before showing so it never appears at the old spot, and a
+        // hidden actor keeps its location dirty until it shows again
+        if ((Bits & DirtyLocation) && Visible[Idx]) {
+            Actor->SetActorLocation(Locations[Idx]);
+            Bits &= ~DirtyLocation;
+        }
+        if (Bits & DirtyVisible) {
+            Actor->SetActorHiddenInGame(!Visible[Idx]);
+            if (ToggleCollision) {
+                Actor->SetActorEnableCollision(Visible[Idx]);
+            }
+            Bits &= ~DirtyVisible;
+        }
+        Bits &= ~Queued;
+    }
+    int Touched = DirtyIdx.Num();
+    DirtyIdx.Reset();
+    return Touched;
+}
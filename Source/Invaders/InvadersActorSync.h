@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+
+// Scene side of the simulation mirror. Callers set what each actor should
+// show, and only actors whose visibility or location differs from what
+// they show now get dirty bits. Flush pushes just those properties, so a
+// frame costs as much as changed in it, not as many actors as exist.
+class INVADERS_API FInvadersActorSync {
+   public:
+    // Collision follows visibility, off for actors spawned without it
+    bool ToggleCollision = true;
+
+    void Reset();
+    // Starts from what the actor shows at the time, returns its index
+    int Add(AActor* Actor);
+    int Num() const { return Actors.Num(); }
+
+    void SetVisible(int Idx, bool Visible);
+    // Held back while the actor is hidden, it moves before it shows again
+    void SetLocation(int Idx, const FVector& Location);
+
+    // Pushes the dirty properties, returns the number of actors touched
+    int Flush();
+
+   private:
+    enum EDirtyBits : uint8 {
+        DirtyVisible = 1 << 0,
+        DirtyLocation = 1 << 1,
+        // Listed in DirtyIdx
+        Queued = 1 << 7,
+    };
+
+    TArray<AActor*> Actors;
+    TArray<FVector> Locations;
+    TArray<bool> Visible;
+    TArray<uint8> Dirty;
+    TArray<int> DirtyIdx;
+
+    void MarkDirty(int Idx, uint8 Bits);
+};
@@ -0,0 +1,126 @@
+#include "InvadersAllocCounter.h"
+
+// Set by count scopes
+static thread_local bool ThreadCounting = false;
+
+FInvadersAllocCounter::~FInvadersAllocCounter() {
+    Uninstall();
+}
+
+FInvadersAllocCounter& FInvadersAllocCounter::Get() {
+    static FInvadersAllocCounter Counter;
+    return Counter;
+}
+
+void FInvadersAllocCounter::Install() {
+    check(!Installed && GMalloc && GMalloc != this);
+    Inner = GMalloc;
+    Installed = true;
+    GMalloc = this;
+}
+
+void FInvadersAllocCounter::Uninstall() {
+    if (!Installed) {
+        return;
+    }
+    // Calls that already picked up the counter keep going through to the
+    // inner allocator, and so does anything installed over the counter
+    if (GMalloc == this) {
+        GMalloc = Inner;
+    }
+    Installed = false;
+}
+
+bool FInvadersAllocCounter::IsThreadCounting() {
+    return ThreadCounting;
+}
+
+bool FInvadersAllocCounter::SetThreadCounting(bool Counting) {
+    const bool WasCounting = ThreadCounting;
+    ThreadCounting = Counting;
+    return WasCounting;
+}
+
+void FInvadersAllocCounter::CountCall() {
+    if (Installed && ThreadCounting) {
+        Calls.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void* FInvadersAllocCounter::Malloc(SIZE_T Count, uint32 Alignment) {
+    CountCall();
+    return Inner->Malloc(Count, Alignment);
+}
+
+void* FInvadersAllocCounter::TryMalloc(SIZE_T Count, uint32 Alignment) {
+    CountCall();
+    return Inner->TryMalloc(Count, Alignment);
+}
+
+void* FInvadersAllocCounter::Realloc(void* Original,
+                                     SIZE_T Count,
+                                     uint32 Alignment) {
+    // A zero size realloc is a free
+    if (Count) {
+        CountCall();
+    }
+    return Inner->Realloc(Original, Count, Alignment);
+}
+
+void* FInvadersAllocCounter::TryRealloc(void* Original,
+                                        SIZE_T Count,
+                                        uint32 Alignment) {
+    if (Count) {
+        CountCall();
+    }
+    return Inner->TryRealloc(Original, Count, Alignment);
+}
+
+void FInvadersAllocCounter::Free(void* Original) {
+    Inner->Free(Original);
+}
+
+SIZE_T FInvadersAllocCounter::QuantizeSize(SIZE_T Count, uint32 Alignment) {
+    return Inner->QuantizeSize(Count, Alignment);
+}
+
+bool FInvadersAllocCounter::GetAllocationSize(void* Original,
+                                              SIZE_T& SizeOut) {
+    return Inner->GetAllocationSize(Original, SizeOut);
+}
+
+void FInvadersAllocCounter::Trim(bool bTrimThreadCaches) {
+    Inner->Trim(bTrimThreadCaches);
+}
+
+void FInvadersAllocCounter::SetupTLSCachesOnCurrentThread() {
+    Inner->SetupTLSCachesOnCurrentThread();
+}
+
+void FInvadersAllocCounter::ClearAndDisableTLSCachesOnCurrentThread() {
+    Inner->ClearAndDisableTLSCachesOnCurrentThread();
+}
+
+void FInvadersAllocCounter::UpdateStats() {
+    Inner->UpdateStats();
+}
+
+void FInvadersAllocCounter::GetAllocatorStats(FGenericMemoryStats& OutStats) {
+    Inner->GetAllocatorStats(OutStats);
+}
+
+void FInvadersAllocCounter::DumpAllocatorStats(FOutputDevice& Ar) {
+    Inner->DumpAllocatorStats(Ar);
+}
+
+bool FInvadersAllocCounter::IsInternallyThreadSafe() const {
+    return Inner->IsInternallyThreadSafe();
+}
+
+bool FInvadersAllocCounter::ValidateHeap() {
+    return Inner->ValidateHeap();
+}
+
+const TCHAR* FInvadersAllocCounter::GetDescriptiveName() {
+    return Inner->GetDescriptiveName();
+}
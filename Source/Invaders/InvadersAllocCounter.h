@@ -0,0 +1,79 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/MemoryBase.h"
+
+#include <atomic>
+
+// Counts the allocations made while installed as GMalloc, passing every
+// call through to the allocator it replaced. The engine's own FMalloc call
+// counters are internal to the allocators and most of them never update
+// them. Only threads inside an FInvadersAllocCountScope are counted, so
+// engine work running beside the measured code doesn't show up. Memory can
+// be freed through either allocator, so it is safe to uninstall with
+// allocations still alive, but the counter has to outlive any call that
+// picked it up as GMalloc.
+class INVADERS_API FInvadersAllocCounter : public FMalloc {
+   public:
+    ~FInvadersAllocCounter();
+
+    // Shared counter, it lives until exit so it can stay installed
+    static FInvadersAllocCounter& Get();
+
+    void Install();
+    void Uninstall();
+    bool IsInstalled() const { return Installed; }
+
+    // Whether the calling thread is inside a count scope
+    static bool IsThreadCounting();
+    // Returns the previous state, see FInvadersAllocCountScope
+    static bool SetThreadCounting(bool Counting);
+
+    // Mallocs and reallocs, frees are not counted
+    uint64 GetCalls() const { return Calls.load(std::memory_order_relaxed); }
+
+    virtual void* Malloc(SIZE_T Count, uint32 Alignment) override;
+    virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override;
+    virtual void* Realloc(void* Original,
+                          SIZE_T Count,
+                          uint32 Alignment) override;
+    virtual void* TryRealloc(void* Original,
+                             SIZE_T Count,
+                             uint32 Alignment) override;
+    virtual void Free(void* Original) override;
+
+    virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override;
+    virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override;
+    virtual void Trim(bool bTrimThreadCaches) override;
+    virtual void SetupTLSCachesOnCurrentThread() override;
+    virtual void ClearAndDisableTLSCachesOnCurrentThread() override;
+    virtual void UpdateStats() override;
+    virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override;
+    virtual void DumpAllocatorStats(FOutputDevice& Ar) override;
+    virtual bool IsInternallyThreadSafe() const override;
+    virtual bool ValidateHeap() override;
+    virtual const TCHAR* GetDescriptiveName() override;
+
+   private:
+    FMalloc* Inner = nullptr;
+    bool Installed = false;
+    std::atomic<uint64> Calls{0};
+
+    void CountCall();
+};
+
+// Counts the calling thread's allocations while alive, or stops counting
+// them if Counting is false. Scopes nest, closing one puts back the state
+// it found. InvadersParallelFor passes the state on to the workers of a
+// loop, so the work a counted step fans out is counted with it.
+class INVADERS_API FInvadersAllocCountScope {
+   public:
+    explicit FInvadersAllocCountScope(bool Counting = true)
+        : WasCounting(FInvadersAllocCounter::SetThreadCounting(Counting)) {}
+    ~FInvadersAllocCountScope() {
+        FInvadersAllocCounter::SetThreadCounting(WasCounting);
+    }
+
+   private:
+    bool WasCounting;
+};
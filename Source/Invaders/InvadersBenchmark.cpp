@@ -0,0 +1,375 @@
+#include "InvadersBenchmark.h"
+
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/PlatformTime.h"
+#include "InvadersAllocCounter.h"
+#include "InvadersInputSource.h"
+#include "InvadersSim.h"
+#include "InvadersSimBatch.h"
+#include "Logging/LogMacros.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+
+static uint64 GetAllocCalls() {
+    return FInvadersAllocCounter::Get().GetCalls();
+}
+
+TUniquePtr<FInvadersBenchmark> FInvadersBenchmark::FromCommandLine() {
+    const TCHAR* CommandLine = FCommandLine::Get();
+    if (!FParse::Param(CommandLine, TEXT("InvadersBenchmark"))) {
+        return nullptr;
+    }
+
+    TUniquePtr<FInvadersBenchmark> Benchmark =
+        MakeUnique<FInvadersBenchmark>();
+    FParse::Value(CommandLine, TEXT("BenchmarkGames="), Benchmark->Games);
+    FParse::Value(CommandLine, TEXT("BenchmarkSteps="),
+                  Benchmark->MaxGameSteps);
+    FParse::Value(CommandLine, TEXT("BenchmarkWarmupSteps="),
+                  Benchmark->WarmupSteps);
+    Benchmark->FailOnAlloc =
+        FParse::Param(CommandLine, TEXT("BenchmarkFailOnAlloc"));
+    Benchmark->RecordReplays =
+        FParse::Param(CommandLine, TEXT("BenchmarkReplays"));
+    Benchmark->Swarm = FParse::Param(CommandLine, TEXT("BenchmarkSwarm"));
+    FParse::Value(CommandLine, TEXT("BenchmarkBatch="),
+                  Benchmark->BatchGames);
+    if (FParse::Param(CommandLine, TEXT("BenchmarkWorkerSweep"))) {
+        int Threads = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+        Benchmark->WorkerCounts.Reset();
+        for (int Workers = 1; Workers < Threads; Workers *= 2) {
+            Benchmark->WorkerCounts.Add(Workers);
+        }
+        Benchmark->WorkerCounts.Add(Threads);
+    }
+    if (!FParse::Value(CommandLine, TEXT("BenchmarkReport="),
+                       Benchmark->ReportPath)) {
+        Benchmark->ReportPath = FPaths::ProjectSavedDir() /
+                                TEXT("Benchmarks") /
+                                FDateTime::Now().ToString() + TEXT(".json");
+    }
+    Benchmark->Games = FMath::Max(Benchmark->Games, 1);
+    Benchmark->Results.Reserve(Benchmark->Games *
+                               Benchmark->WorkerCounts.Num());
+    return Benchmark;
+}
+
+void FInvadersBenchmark::BeginGame() {
+    GameSteps = 0;
+    GameStartTime = FPlatformTime::Seconds();
+    GameStartCycles = StepCycles;
+}
+
+bool FInvadersBenchmark::EndGame(const FInvadersGameState& State) {
+    if (InstalledCounter) {
+        FInvadersAllocCounter::Get().Uninstall();
+        InstalledCounter = false;
+    }
+    FGameResult Result;
+    Result.Workers = GetWorkers();
+    Result.Steps = GameSteps;
+    Result.Score = State.Score;
+    Result.Level = State.CurrentLevel;
+    Result.Seconds = FPlatformTime::Seconds() - GameStartTime;
+    Result.StepCycles = StepCycles - GameStartCycles;
+    Results.Add(Result);
+
+    const int TotalGames = Games * WorkerCounts.Num();
+    UE_LOG(LogTemp, Log,
+           TEXT("Benchmark game %d/%d: %d steps in %.2fs, %d workers"),
+           Results.Num(), TotalGames, Result.Steps, Result.Seconds,
+           Result.Workers);
+    if (Results.Num() % Games == 0) {
+        WorkerIdx = FMath::Min(WorkerIdx + 1, WorkerCounts.Num() - 1);
+    }
+    return Results.Num() >= TotalGames;
+}
+
+void FInvadersBenchmark::BeginStep() {
+    // The counter adds to every allocation, so it is only installed for
+    // the steps after the warmup, the ones it counts
+    if (GameSteps >= WarmupSteps) {
+        FInvadersAllocCounter& Counter = FInvadersAllocCounter::Get();
+        if (!Counter.IsInstalled()) {
+            Counter.Install();
+            InstalledCounter = true;
+        }
+        WasCountingAllocs = FInvadersAllocCounter::SetThreadCounting(true);
+        StepStartAllocs = GetAllocCalls();
+    }
+    StepStartCycles = FPlatformTime::Cycles64();
+}
+
+void FInvadersBenchmark::EndStep(int Bullets) {
+    StepCycles += FPlatformTime::Cycles64() - StepStartCycles;
+    StepBullets += Bullets;
+    // The first steps of a game fill lazily created engine state
+    if (GameSteps >= WarmupSteps) {
+        FInvadersAllocCounter::SetThreadCounting(WasCountingAllocs);
+        StepAllocs += GetAllocCalls() - StepStartAllocs;
+        SteadySteps++;
+    }
+    GameSteps++;
+}
+
+void FInvadersBenchmark::MeasureSnapshot(FInvadersSim& Sim) {
+    uint64 StartCycles = FPlatformTime::Cycles64();
+    Sim.SaveSnapshot(Snapshot);
+    uint64 SavedCycles = FPlatformTime::Cycles64();
+    bool Loaded = Sim.LoadSnapshot(Snapshot);
+    SnapshotLoadCycles += FPlatformTime::Cycles64() - SavedCycles;
+    SnapshotSaveCycles += SavedCycles - StartCycles;
+    Snapshots++;
+
+    Sim.SaveSnapshot(SnapshotCheck);
+    if (!Loaded || SnapshotCheck != Snapshot) {
+        UE_LOG(LogTemp, Error, TEXT("Snapshot round trip changed the state"));
+        SnapshotMismatches++;
+    }
+}
+
+void FInvadersBenchmark::MeasureBatch(const FInvadersSimConfig& Config,
+                                      float StepTime) {
+    UE_LOG(LogTemp, Log, TEXT("Benchmarking a batch of %d games"),
+           BatchGames);
+
+    FInvadersSimBatch Batch;
+    Batch.MaxGameSteps = MaxGameSteps;
+    Batch.Init(Config, BatchGames);
+    Batch.Reset();
+
+    FInvadersSim Lone;
+    Lone.Init(Batch.GetGame(0).Config);
+    Lone.Restart();
+
+    TArray<FInvadersSweepInput> Sources;
+    Sources.SetNum(BatchGames);
+    TArray<FInvadersInput> Inputs;
+    Inputs.SetNum(BatchGames);
+    TArray<uint8> LoneSnapshot;
+    TArray<uint8> BatchSnapshot;
+
+    for (int Step = 0; Step < BatchSteps; Step++) {
+        for (int Game = 0; Game < BatchGames; Game++) {
+            FInvadersInputFrame Frame =
+                Sources[Game].MakeInput(Batch.GetGame(Game));
+            Inputs[Game].SideMovement = Frame.GetSideMovement();
+            Inputs[Game].ShootPressed = Frame.ShootPressed;
+            Inputs[Game].ShootReleased = Frame.ShootReleased;
+        }
+        // The batch restarts a done game at the start of the next step
+        const bool LoneDone = Batch.GetDones()[0] != 0;
+
+        uint64 StartCycles = FPlatformTime::Cycles64();
+        Batch.Step(StepTime, Inputs);
+        uint64 BatchedCycles = FPlatformTime::Cycles64();
+        if (LoneDone) {
+            Lone.Restart();
+        }
+        Lone.Step(StepTime, Inputs[0]);
+        BatchLoneCycles += FPlatformTime::Cycles64() - BatchedCycles;
+        BatchCycles += BatchedCycles - StartCycles;
+
+        Lone.SaveSnapshot(LoneSnapshot);
+        Batch.GetGame(0).SaveSnapshot(BatchSnapshot);
+        if (LoneSnapshot != BatchSnapshot) {
+            BatchMismatches++;
+        }
+    }
+    if (BatchMismatches > 0) {
+        UE_LOG(LogTemp, Error,
+               TEXT("Batched game left the lone game's state in %d steps"),
+               BatchMismatches);
+    }
+}
+
+void FInvadersBenchmark::WriteReport() const {
+    FString Report =
+        ReportPath.EndsWith(TEXT(".csv")) ? MakeCsv() : MakeJson();
+    if (FFileHelper::SaveStringToFile(Report, *ReportPath)) {
+        UE_LOG(LogTemp, Log, TEXT("Benchmark report written to %s"),
+               *ReportPath);
+    } else {
+        UE_LOG(LogTemp, Error, TEXT("Can't write benchmark report %s"),
+               *ReportPath);
+    }
+}
+
+bool FInvadersBenchmark::CheckAllocations() const {
+    if (!FailOnAlloc) {
+        return false;
+    }
+    if (StepAllocs > 0) {
+        UE_LOG(LogTemp, Error,
+               TEXT("Benchmark steps made %llu allocations after warmup"),
+               StepAllocs);
+        return true;
+    }
+    return false;
+}
+
+static double CyclesToNs(uint64 Cycles, int Steps) {
+    return Steps ? FPlatformTime::ToMilliseconds64(Cycles) * 1e6 / Steps
+                 : 0.0;
+}
+
+TArray<FInvadersBenchmark::FScalingPoint> FInvadersBenchmark::GetScaling()
+    const {
+    TArray<FScalingPoint> Scaling;
+    if (WorkerCounts.Num() < 2) {
+        return Scaling;
+    }
+    for (int Workers : WorkerCounts) {
+        int Steps = 0;
+        uint64 Cycles = 0;
+        for (const FGameResult& Result : Results) {
+            if (Result.Workers == Workers) {
+                Steps += Result.Steps;
+                Cycles += Result.StepCycles;
+            }
+        }
+        FScalingPoint Point;
+        Point.Workers = Workers;
+        Point.StepNs = CyclesToNs(Cycles, Steps);
+        Point.Speedup = Point.StepNs > 0 && Scaling.Num() > 0
+                            ? Scaling[0].StepNs / Point.StepNs
+                            : 1.0;
+        Scaling.Add(Point);
+    }
+    return Scaling;
+}
+
+FString FInvadersBenchmark::MakeCsv() const {
+    int Steps = 0;
+    double Seconds = 0.0;
+    for (const FGameResult& Result : Results) {
+        Steps += Result.Steps;
+        Seconds += Result.Seconds;
+    }
+
+    FString Csv = TEXT("metric,value\n");
+    Csv += FString::Printf(TEXT("games,%d\n"), Results.Num());
+    Csv += FString::Printf(TEXT("steps,%d\n"), Steps);
+    Csv += FString::Printf(TEXT("seconds,%.3f\n"), Seconds);
+    Csv += FString::Printf(TEXT("ticks_per_sec,%.1f\n"),
+                           Seconds > 0 ? Steps / Seconds : 0.0);
+    Csv += FString::Printf(TEXT("step_ns,%.0f\n"),
+                           CyclesToNs(StepCycles, Steps));
+    Csv += FString::Printf(TEXT("swarm,%d\n"), Swarm);
+    Csv += FString::Printf(TEXT("bullets_mean,%.1f\n"),
+                           Steps ? double(StepBullets) / Steps : 0.0);
+    Csv += FString::Printf(TEXT("steady_steps,%llu\n"), SteadySteps);
+    Csv += FString::Printf(TEXT("steady_allocs_total,%llu\n"), StepAllocs);
+    Csv += FString::Printf(
+        TEXT("steady_allocs_per_step,%.4f\n"),
+        SteadySteps ? double(StepAllocs) / SteadySteps : 0.0);
+    Csv += FString::Printf(TEXT("snapshot_bytes,%d\n"), Snapshot.Num());
+    Csv += FString::Printf(TEXT("snapshot_save_ns,%.0f\n"),
+                           CyclesToNs(SnapshotSaveCycles, Snapshots));
+    Csv += FString::Printf(TEXT("snapshot_load_ns,%.0f\n"),
+                           CyclesToNs(SnapshotLoadCycles, Snapshots));
+    Csv += FString::Printf(TEXT("snapshot_mismatches,%d\n"),
+                           SnapshotMismatches);
+    Csv += FString::Printf(TEXT("batch_games,%d\n"), BatchGames);
+    Csv += FString::Printf(TEXT("batch_steps,%d\n"),
+                           BatchGames ? BatchSteps : 0);
+    Csv += FString::Printf(TEXT("batch_step_ns,%.0f\n"),
+                           CyclesToNs(BatchCycles, BatchSteps));
+    Csv += FString::Printf(TEXT("batch_game_step_ns,%.1f\n"),
+                           CyclesToNs(BatchCycles, BatchSteps * BatchGames));
+    Csv += FString::Printf(TEXT("batch_lone_step_ns,%.1f\n"),
+                           CyclesToNs(BatchLoneCycles, BatchSteps));
+    Csv += FString::Printf(TEXT("batch_mismatches,%d\n"), BatchMismatches);
+    for (const FScalingPoint& Point : GetScaling()) {
+        Csv += FString::Printf(TEXT("workers_%d_step_ns,%.0f\n"),
+                               Point.Workers, Point.StepNs);
+        Csv += FString::Printf(TEXT("workers_%d_speedup,%.2f\n"),
+                               Point.Workers, Point.Speedup);
+    }
+    for (int Phase = 0; Phase < int(EInvadersPhase::Num); Phase++) {
+        Csv += FString::Printf(TEXT("%s_ns,%.0f\n"),
+                               GetPhaseName(EInvadersPhase(Phase)),
+                               CyclesToNs(PhaseTimes.Cycles[Phase], Steps));
+    }
+    return Csv;
+}
+
+FString FInvadersBenchmark::MakeJson() const {
+    int Steps = 0;
+    double Seconds = 0.0;
+    FString Games;
+    for (const FGameResult& Result : Results) {
+        Steps += Result.Steps;
+        Seconds += Result.Seconds;
+        Games += FString::Printf(
+            TEXT("%s\n    {\"workers\": %d, \"steps\": %d, ")
+                TEXT("\"score\": %d, \"level\": %d, \"seconds\": %.3f}"),
+            Games.IsEmpty() ? TEXT("") : TEXT(","), Result.Workers,
+            Result.Steps, Result.Score, Result.Level, Result.Seconds);
+    }
+
+    FString Scaling;
+    for (const FScalingPoint& Point : GetScaling()) {
+        Scaling += FString::Printf(
+            TEXT("%s\n    {\"workers\": %d, \"step_ns\": %.0f, ")
+                TEXT("\"speedup\": %.2f}"),
+            Scaling.IsEmpty() ? TEXT("") : TEXT(","), Point.Workers,
+            Point.StepNs, Point.Speedup);
+    }
+
+    FString Phases;
+    for (int Phase = 0; Phase < int(EInvadersPhase::Num); Phase++) {
+        Phases += FString::Printf(
+            TEXT("%s\n    \"%s\": %.0f"), Phase ? TEXT(",") : TEXT(""),
+            GetPhaseName(EInvadersPhase(Phase)),
+            CyclesToNs(PhaseTimes.Cycles[Phase], Steps));
+    }
+
+    FString Json = TEXT("{\n");
+    Json += FString::Printf(TEXT("  \"games\": %d,\n"), Results.Num());
+    Json += FString::Printf(TEXT("  \"steps\": %d,\n"), Steps);
+    Json += FString::Printf(TEXT("  \"seconds\": %.3f,\n"), Seconds);
+    Json += FString::Printf(TEXT("  \"ticks_per_sec\": %.1f,\n"),
+                            Seconds > 0 ? Steps / Seconds : 0.0);
+    Json += FString::Printf(TEXT("  \"step_ns\": %.0f,\n"),
+                            CyclesToNs(StepCycles, Steps));
+    Json += FString::Printf(TEXT("  \"swarm\": %s,\n"),
+                            Swarm ? TEXT("true") : TEXT("false"));
+    Json += FString::Printf(TEXT("  \"bullets_mean\": %.1f,\n"),
+                            Steps ? double(StepBullets) / Steps : 0.0);
+    Json += FString::Printf(TEXT("  \"steady_steps\": %llu,\n"),
+                            SteadySteps);
+    Json += FString::Printf(TEXT("  \"steady_allocs_total\": %llu,\n"),
+                            StepAllocs);
+    Json += FString::Printf(
+        TEXT("  \"steady_allocs_per_step\": %.4f,\n"),
+        SteadySteps ? double(StepAllocs) / SteadySteps : 0.0);
+    Json += FString::Printf(TEXT("  \"snapshot_bytes\": %d,\n"),
+                            Snapshot.Num());
+    Json += FString::Printf(TEXT("  \"snapshot_save_ns\": %.0f,\n"),
+                            CyclesToNs(SnapshotSaveCycles, Snapshots));
+    Json += FString::Printf(TEXT("  \"snapshot_load_ns\": %.0f,\n"),
+                            CyclesToNs(SnapshotLoadCycles, Snapshots));
+    Json += FString::Printf(TEXT("  \"snapshot_mismatches\": %d,\n"),
+                            SnapshotMismatches);
+    Json += FString::Printf(TEXT("  \"batch_games\": %d,\n"), BatchGames);
+    Json += FString::Printf(TEXT("  \"batch_steps\": %d,\n"),
+                            BatchGames ? BatchSteps : 0);
+    Json += FString::Printf(TEXT("  \"batch_step_ns\": %.0f,\n"),
+                            CyclesToNs(BatchCycles, BatchSteps));
+    Json += FString::Printf(
+        TEXT("  \"batch_game_step_ns\": %.1f,\n"),
+        CyclesToNs(BatchCycles, BatchSteps * BatchGames));
+    Json += FString::Printf(TEXT("  \"batch_lone_step_ns\": %.1f,\n"),
+                            CyclesToNs(BatchLoneCycles, BatchSteps));
+    Json += FString::Printf(TEXT("  \"batch_mismatches\": %d,\n"),
+                            BatchMismatches);
+    Json += FString::Printf(TEXT("  \"phase_ns\": {%s\n  },\n"), *Phases);
+    Json += FString::Printf(TEXT("  \"scaling\": [%s\n  ],\n"), *Scaling);
+    Json += FString::Printf(TEXT("  \"results\": [%s\n  ]\n"), *Games);
+    Json += TEXT("}\n");
+    return Json;
+}
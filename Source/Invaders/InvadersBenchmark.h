@@ -0,0 +1,134 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InvadersReplay.h"
+#include "InvadersStats.h"
+#include "Templates/UniquePtr.h"
+
+class FInvadersSim;
+struct FInvadersGameState;
+struct FInvadersSimConfig;
+
+// Headless benchmark run, enabled with -InvadersBenchmark and meant for
+// -nullrhi. Plays a number of games with scripted input, one simulation
+// step per frame with no frame rate limit, and writes a CSV or JSON report
+// picked by the report file extension. The input sweeps side to side
+// unless -InvadersInput= picks another source.
+//
+//   -BenchmarkGames=N       games to play, default 10
+//   -BenchmarkSteps=N       step limit of a game, default 5 min at 120 Hz
+//   -BenchmarkReport=Path   default Saved/Benchmarks/<date>.json
+//   -BenchmarkWarmupSteps=N steps of a game left out of the allocation
+//                           count, default 240. The stepping thread's
+//                           allocations are counted, and those of the
+//                           workers the simulation fans out to, see
+//                           FInvadersAllocCountScope. The counter is only
+//                           installed as GMalloc for the counted steps.
+//   -BenchmarkFailOnAlloc   exit with an error code if the steps after
+//                           the warmup allocated
+//   -BenchmarkWorkerSweep   play the games once per simulation worker
+//                           count, 1, 2, 4 and so on up to all threads
+//   -BenchmarkReplays       record a replay of every game, off by default
+//   -BenchmarkSwarm         play the swarm rules below instead of the
+//                           level's, a formation and bullet counts large
+//                           enough for the worker sweep to split the work
+//   -BenchmarkBatch=N       before the games, step N headless games of the
+//                           level's configuration in one batch, checked
+//                           against game 0 stepped on its own
+class INVADERS_API FInvadersBenchmark {
+   public:
+    int Games = 10;
+    int MaxGameSteps = 120 * 60 * 5;
+    int WarmupSteps = 240;
+    bool FailOnAlloc = false;
+    bool RecordReplays = false;
+    // Swarm rules. Enemies and the player shoot every step into pools this
+    // big, and lives last until the step limit. The hundreds of bullets
+    // in flight are past the simulation's MinBatch and split over the
+    // workers, where the shipped pools of 20 always run inline.
+    bool Swarm = false;
+    int SwarmEnemiesInRow = 100;
+    int SwarmEnemiesInColumn = 40;
+    int SwarmMaxBullets = 2048;
+    // Batch run, off with zero games
+    int BatchGames = 0;
+    int BatchSteps = 120 * 60;
+    // Simulation worker counts to play the games with, zero is the default
+    TArray<int> WorkerCounts = {0};
+    FString ReportPath;
+
+    FInvadersPhaseTimes PhaseTimes;
+
+    // Null unless the command line asks for a benchmark
+    static TUniquePtr<FInvadersBenchmark> FromCommandLine();
+
+    void BeginGame();
+    int GetWorkers() const { return WorkerCounts[WorkerIdx]; }
+    // Returns true once all games have been played
+    bool EndGame(const FInvadersGameState& State);
+    bool IsStepLimitReached() const { return GameSteps >= MaxGameSteps; }
+    // Times a snapshot save and load of the state, and checks that a save
+    // of the loaded state matches
+    void MeasureSnapshot(FInvadersSim& Sim);
+    // Times the batch run with sweeping input. Game 0 of the batch is
+    // stepped alongside as a lone simulation too, for the per game cost
+    // without batching and to check that both stay in the same state.
+    void MeasureBatch(const FInvadersSimConfig& Config, float StepTime);
+
+    void BeginStep();
+    // Bullets is the number alive after the step
+    void EndStep(int Bullets);
+
+    void WriteReport() const;
+    // Logs the failure, true if the run should exit with an error code
+    bool CheckAllocations() const;
+
+   private:
+    struct FGameResult {
+        int Workers;
+        int Steps;
+        int Score;
+        int Level;
+        double Seconds;
+        uint64 StepCycles;
+    };
+    TArray<FGameResult> Results;
+
+    int WorkerIdx = 0;
+    int GameSteps = 0;
+    uint64 GameStartCycles = 0;
+    double GameStartTime = 0.0;
+
+    uint64 StepStartCycles = 0;
+    uint64 StepStartAllocs = 0;
+    bool WasCountingAllocs = false;
+    // Installed for the steps after the warmup until the game ends
+    bool InstalledCounter = false;
+    uint64 StepCycles = 0;
+    // Allocations and steps after each game's warmup
+    uint64 StepAllocs = 0;
+    uint64 SteadySteps = 0;
+    uint64 StepBullets = 0;
+
+    TArray<uint8> Snapshot;
+    TArray<uint8> SnapshotCheck;
+    int Snapshots = 0;
+    int SnapshotMismatches = 0;
+    uint64 SnapshotSaveCycles = 0;
+    uint64 SnapshotLoadCycles = 0;
+
+    uint64 BatchCycles = 0;
+    uint64 BatchLoneCycles = 0;
+    int BatchMismatches = 0;
+
+    FString MakeCsv() const;
+    FString MakeJson() const;
+
+    struct FScalingPoint {
+        int Workers;
+        double StepNs;
+        double Speedup;
+    };
+    // Mean step time per worker count, empty without a sweep
+    TArray<FScalingPoint> GetScaling() const;
+};
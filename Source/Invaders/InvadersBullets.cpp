@@ -0,0 +1,128 @@
+#include "InvadersBullets.h"
+
+#include "Math/VectorRegister.h"
+
+/// LANES ///
+
+void FInvadersBulletLanes::Init(int Stores, int Capacity) {
+    // Round up to whole vectors so the kernel never reads past a store
+    Stride = FMath::DivideAndRoundUp(Capacity, 4) * 4;
+    const int Lanes = Stores * Stride;
+    PosX.SetNumZeroed(Lanes);
+    PosY.SetNumZeroed(Lanes);
+    VelY.SetNumZeroed(Lanes);
+    Owner.SetNumZeroed(Lanes);
+    CullMasks.SetNumZeroed(Lanes / 4);
+}
+
+void FInvadersBulletLanes::Move(float DeltaSeconds,
+                                float Range,
+                                int Begin,
+                                int End) {
+    const VectorRegister4Float Delta = VectorSetFloat1(DeltaSeconds);
+    const VectorRegister4Float Limit = VectorSetFloat1(Range);
+
+    // Lanes past a store's Num hold stale bullets, they are moved but never
+    // culled
+    for (int Group = Begin; Group < End; Group++) {
+        const int Idx = Group * 4;
+        VectorRegister4Float Y = VectorLoad(&PosY[Idx]);
+        VectorRegister4Float V = VectorLoad(&VelY[Idx]);
+        Y = VectorMultiplyAdd(V, Delta, Y);
+        VectorStore(Y, &PosY[Idx]);
+
+        // Travelled past range along the heading: Y * V > Range * |V|
+        VectorRegister4Float Past = VectorCompareGT(
+            VectorMultiply(Y, V), VectorMultiply(Limit, VectorAbs(V)));
+        CullMasks[Group] = uint8(VectorMaskBits(Past));
+    }
+}
+
+/// STORE ///
+
+void FInvadersBullets::Bind(FInvadersBulletLanes& InLanes,
+                            int Store,
+                            int InCapacity) {
+    check(InCapacity <= InLanes.Stride);
+    Lanes = &InLanes;
+    Capacity = InCapacity;
+    Num = 0;
+
+    const int First = Store * InLanes.Stride;
+    PosX = TArrayView<float>(InLanes.PosX).Slice(First, InLanes.Stride);
+    PosY = TArrayView<float>(InLanes.PosY).Slice(First, InLanes.Stride);
+    VelY = TArrayView<float>(InLanes.VelY).Slice(First, InLanes.Stride);
+    Owner = TArrayView<uint32>(InLanes.Owner).Slice(First, InLanes.Stride);
+    FirstGroup = First / 4;
+    CullMasks = TArrayView<uint8>(InLanes.CullMasks)
+                    .Slice(FirstGroup, InLanes.Stride / 4);
+}
+
+bool FInvadersBullets::Add(const FVector2D& Pos,
+                           float Velocity,
+                           uint32 OwnerId) {
+    if (Num >= Capacity) {
+        return false;
+    }
+    PosX[Num] = Pos[0];
+    PosY[Num] = Pos[1];
+    VelY[Num] = Velocity;
+    Owner[Num] = OwnerId;
+    Num++;
+    return true;
+}
+
+void FInvadersBullets::RemoveAtSwap(int Idx) {
+    check(Idx < Num);
+    Num--;
+    PosX[Idx] = PosX[Num];
+    PosY[Idx] = PosY[Num];
+    VelY[Idx] = VelY[Num];
+    Owner[Idx] = Owner[Num];
+}
+
+void FInvadersBullets::Move(float DeltaSeconds,
+                            float Range,
+                            const FInvadersParallelConfig& Parallel) {
+    FInvadersParallelConfig GroupParallel = Parallel;
+    GroupParallel.MinBatch = FMath::Max(Parallel.MinBatch / 4, 1);
+    InvadersParallelFor(
+        GroupParallel, FMath::DivideAndRoundUp(Num, 4),
+        [&](int Begin, int End) {
+            Lanes->Move(DeltaSeconds, Range, FirstGroup + Begin,
+                        FirstGroup + End);
+        });
+}
+
+void FInvadersBullets::RemoveCulled() {
+    const int Groups = FMath::DivideAndRoundUp(Num, 4);
+    if (Num % 4) {
+        CullMasks[Groups - 1] &= (1 << (Num % 4)) - 1;
+    }
+
+    // Remove back to front so the swapped in bullet is always a kept one
+    for (int Group = Groups - 1; Group >= 0; Group--) {
+        uint8 Mask = CullMasks[Group];
+        for (int Lane = 3; Mask && Lane >= 0; Lane--) {
+            if (Mask & (1 << Lane)) {
+                RemoveAtSwap(Group * 4 + Lane);
+                Mask &= ~(1 << Lane);
+            }
+        }
+    }
+}
+
+FArchive& operator<<(FArchive& Ar, FInvadersBullets& Bullets) {
+    int32 Num = Bullets.Num;
+    Ar << Num;
+    if (Num < 0 || Num > Bullets.Capacity) {
+        Ar.SetError();
+        return Ar;
+    }
+    Bullets.Num = Num;
+    Ar.Serialize(Bullets.PosX.GetData(), Num * sizeof(float));
+    Ar.Serialize(Bullets.PosY.GetData(), Num * sizeof(float));
+    Ar.Serialize(Bullets.VelY.GetData(), Num * sizeof(float));
+    Ar.Serialize(Bullets.Owner.GetData(), Num * sizeof(uint32));
+    return Ar;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InvadersParallel.h"
+
+// Bullet arrays of several stores back to back, store S owns the Stride
+// lanes from S * Stride. The stride is rounded up to whole vectors, so a
+// vector never straddles two stores and all of them can be moved in one
+// pass.
+struct INVADERS_API FInvadersBulletLanes {
+    TArray<float> PosX;
+    TArray<float> PosY;
+    TArray<float> VelY;
+    // Entity id of the unit that fired the bullet
+    TArray<uint32> Owner;
+    // Cull lanes of each four bullet group, written by Move
+    TArray<uint8> CullMasks;
+
+    int Stride = 0;
+
+    void Init(int Stores, int Capacity);
+
+    int GetGroupNum() const { return CullMasks.Num(); }
+
+    // Moves every lane of the four bullet groups [Begin, End) and marks
+    // the ones that travelled past Range in their heading
+    void Move(float DeltaSeconds, float Range, int Begin, int End);
+};
+
+// Structure of arrays bullet store, one store of an FInvadersBulletLanes.
+// Live bullets are packed at the front, removal swaps the last live bullet
+// into the hole. Bullets travel along the y-axis only.
+struct INVADERS_API FInvadersBullets {
+    TArrayView<float> PosX;
+    TArrayView<float> PosY;
+    TArrayView<float> VelY;
+    TArrayView<uint32> Owner;
+
+    int Num = 0;
+    int Capacity = 0;
+
+    void Bind(FInvadersBulletLanes& Lanes, int Store, int InCapacity);
+    void Reset() { Num = 0; }
+
+    // Returns false when the store is full
+    bool Add(const FVector2D& Pos, float Velocity, uint32 OwnerId);
+    void RemoveAtSwap(int Idx);
+
+    FVector2D GetPos(int Idx) const {
+        return FVector2D(PosX[Idx], PosY[Idx]);
+    }
+
+    // Moves the live bullets and marks the ones past Range. Batches move
+    // the whole lanes instead.
+    void Move(float DeltaSeconds,
+              float Range,
+              const FInvadersParallelConfig& Parallel = {});
+    // Removes the live bullets marked by the last move
+    void RemoveCulled();
+
+    // Live bullets only, loading into a store of the same capacity
+    friend FArchive& operator<<(FArchive& Ar, FInvadersBullets& Bullets);
+
+   private:
+    FInvadersBulletLanes* Lanes = nullptr;
+    // First group of the store in the lanes
+    int FirstGroup = 0;
+    TArrayView<uint8> CullMasks;
+};
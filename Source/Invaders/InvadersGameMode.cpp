@@ -6,9 +6,14 @@
 #include "Components/ActorComponent.h"
 #include "Components/Button.h"
 #include "Components/InputComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
 #include "Components/MeshComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Components/SceneCaptureComponent2D.h"
 #include "Components/SceneComponent.h"
+#include "Components/StaticMeshComponent.h"
 #include "Components/TextBlock.h"
+#include "Engine/AssetManager.h"
 #include "DataTypes.h"
 #include "Engine/Blueprint.h"
 #include "Engine/EngineBaseTypes.h"
@@ -19,38 +24,139 @@
 #include "GameFramework/PlayerController.h"
 #include "GameUtils.h"
 #include "GenericPlatform/GenericPlatformMath.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformTime.h"
 #include "Internationalization/Internationalization.h"
 #include "Internationalization/Text.h"
 #include "Kismet/GameplayStatics.h"
 #include "Layout/Geometry.h"
 #include "Logging/LogMacros.h"
 #include "Logging/LogVerbosity.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Materials/MaterialParameterCollection.h"
+#include "Materials/MaterialParameterCollectionInstance.h"
 #include "Math/MathFwd.h"
 #include "Math/UnrealMathUtility.h"
+#include "Misc/App.h"
 #include "Misc/AssertionMacros.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
 #include "Misc/MemStack.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
 #include "Sound/SoundWave.h"
 #include "Templates/Casts.h"
+#include "Templates/TypeHash.h"
 #include "UObject/UObjectGlobals.h"
 
-const int MAX_BULLETS = 20;
+static FVector ToWorld(const FVector2D& Pos, float Z) {
+    return FVector(Pos[0], Pos[1], Z);
+}
+
+// Bounds of the components that would collide, measured from their own
+// settings so that actors spawned without collision still have a size
+static FVector2D GetActorExtent(AActor* Actor) {
+    FBox Bounds(ForceInit);
+    TInlineComponentArray<UPrimitiveComponent*> Components(Actor);
+    for (UPrimitiveComponent* Component : Components) {
+        if (Component->IsRegistered() &&
+            Component->BodyInstance.GetCollisionEnabled(false) !=
+                ECollisionEnabled::NoCollision) {
+            Bounds += Component->Bounds.GetBox();
+        }
+    }
+    return FVector2D(Bounds.GetExtent());
+}
+
+static FUnitRenderHandle MakeRenderHandle(UMeshComponent* Mesh) {
+    FUnitRenderHandle Handle;
+    Handle.Mesh = Mesh;
+    if (Mesh) {
+        Handle.Material = Cast<UMaterialInstanceDynamic>(Mesh->GetMaterial(0));
+    }
+    return Handle;
+}
+
+static void SetAppearMaterial(const FUnitRenderHandle& Handle,
+                              float Gamma,
+                              float Opacity) {
+    if (Handle.Material) {
+        Handle.Material->SetScalarParameterValue("Gamma", Gamma);
+        Handle.Material->SetScalarParameterValue("Opacity", Opacity);
+    }
+}
+
+static void SetEntityId(AActor* Actor, uint32 EntityId) {
+    UInvadersEntityComponent* Entity =
+        NewObject<UInvadersEntityComponent>(Actor);
+    Entity->EntityId = EntityId;
+    Entity->RegisterComponent();
+}
+
+static uint32 GetEntityId(const AActor* Actor) {
+    const UInvadersEntityComponent* Entity =
+        Actor->FindComponentByClass<UInvadersEntityComponent>();
+    return Entity ? Entity->EntityId : 0;
+}
+
+static UPrimitiveComponent* FindOverlapComponent(AActor* Actor) {
+    TInlineComponentArray<UPrimitiveComponent*> Components(Actor);
+    for (UPrimitiveComponent* Component : Components) {
+        if (Component->GetGenerateOverlapEvents()) {
+            return Component;
+        }
+    }
+    return nullptr;
+}
+
+// Entity id of the first actor overlapping the component, zero if none
+static uint32 GetOverlapEntityId(const UPrimitiveComponent* Component) {
+    const TArray<FOverlapInfo>& Overlaps = Component->GetOverlapInfos();
+    if (Overlaps.Num() == 0) {
+        return 0;
+    }
+    AActor* Actor = Overlaps[0].OverlapInfo.GetActor();
+    return Actor ? GetEntityId(Actor) : 0;
+}
+
+static void SyncBulletActors(FInvadersActorSync& ActorSync,
+                             int FirstIdx,
+                             const FInvadersBullets& Bullets,
+                             float Z,
+                             float Rewind,
+                             int& ShownNum) {
+    // Only the live range and the bullets that died since the last sync
+    // can differ
+    int Num = FMath::Max(Bullets.Num, ShownNum);
+    for (int Idx = 0; Idx < Num; Idx++) {
+        bool Active = Idx < Bullets.Num;
+        if (Active) {
+            // Bullets fly straight, stepping back along the velocity is
+            // the same as blending with the previous position
+            FVector2D Pos = Bullets.GetPos(Idx);
+            Pos[1] -= Bullets.VelY[Idx] * Rewind;
+            ActorSync.SetLocation(FirstIdx + Idx, ToWorld(Pos, Z));
+        }
+        ActorSync.SetVisible(FirstIdx + Idx, Active);
+    }
+    ShownNum = Bullets.Num;
+}
+
+static FTransform ScaledTransform(const FTransform& Transform, float Scale) {
+    return FTransform(Transform.GetRotation(), Transform.GetLocation(),
+                      Transform.GetScale3D() * Scale);
+}
 
 void AInvadersGameMode::InitGame(const FString& MapName,
                                  const FString& Options,
                                  FString& ErrorMessage) {
     Super::InitGame(MapName, Options, ErrorMessage);
-    const int EnemyNum = Rules.EnemiesInRow * Rules.EnemiesInColumn;
-    InvadersGameState = {
-        false, 0, 0, 0, 0, EnemyNum, EnemyNum, 0, 0, 0, PlayerDef.Lives, 0,
-    };
 
-    PlayerBullets.Reserve(MAX_BULLETS);
-    EnemyBullets.Reserve(MAX_BULLETS);
+    PlayerBullets.Reserve(PlayerBulletDef.MaxBullets);
+    EnemyBullets.Reserve(EnemyBulletDef.MaxBullets);
 
-    ShootingEnemies.Reserve(10);
-    EnemyShips.Reserve(InvadersGameState.TotalEnemyNum);
+    EnemyShips.Reserve(Rules.EnemiesInRow * Rules.EnemiesInColumn);
     Asteroids.Reserve(4);
-    AsteroidHP.Reserve(4);
 }
 
 void AInvadersGameMode::QuitGame() {
@@ -62,20 +168,38 @@ void AInvadersGameMode::QuitGame() {
 void AInvadersGameMode::StartPlay() {
     Super::StartPlay();
 
-    // Map enemy scoring points
-    for (FEnemyDef& Def : EnemyDefs) {
-        EnemyPointMap.Add(Def.ShipClass, Def.Points);
+    FParse::Value(FCommandLine::Get(), TEXT("InvadersReplay="), ReplayPath);
+    FParse::Value(FCommandLine::Get(), TEXT("InvadersMaxReplays="),
+                  MaxReplays);
+    Benchmark = FInvadersBenchmark::FromCommandLine();
+    if (Benchmark && Benchmark->Swarm) {
+        ApplySwarmRules();
     }
 
-    LoadHiScore();
+    FString InputName = Benchmark ? TEXT("Sweep") : TEXT("");
+    FParse::Value(FCommandLine::Get(), TEXT("InvadersInput="), InputName);
+    InputSource = IInvadersInputSource::Create(InputName, 1.f / Rules.SimRate);
 
     InitInput();
-    InitGameObjects();
+    InitSimulation();
+    LoadGameClasses();
+    if (Benchmark) {
+        // Nothing to show while waiting
+        GameClassesHandle->WaitUntilComplete();
+        HandleGameClassesLoaded();
+        return;
+    }
+    LoadHiScore();
     InitUIWidgets();
 
     InitSounds();
 
-    ShowMainMenu();
+    // Replays start once loaded, there is no one at the menu
+    if (ReplayPath.IsEmpty()) {
+        ShowMainMenu();
+        UE_LOG(LogTemp, Log, TEXT("Main menu shown %.2fs after startup"),
+               FPlatformTime::Seconds() - GStartTime);
+    }
 }
 
 /// INIT FUNCTIONS //
@@ -95,6 +219,17 @@ void AInvadersGameMode::InitSounds() {
 
     UGameplayStatics::PlaySound2D(GetWorld(), BgAudioMusic);
     UGameplayStatics::PlaySound2D(GetWorld(), ChatterAudioMusic);
+
+    for (int Idx = 0; Idx < ExplosionVoices; Idx++) {
+        UAudioComponent* Voice = NewObject<UAudioComponent>(this);
+        Voice->bAutoActivate = false;
+        Voice->bAutoDestroy = false;
+        Voice->bAllowSpatialization = true;
+        Voice->RegisterComponent();
+        ExplosionVoicePool.Add(Voice);
+    }
+    NextExplosionVoice = 0;
+    FrameExplosions.Reserve(ExplosionVoices);
 }
 
 void AInvadersGameMode::InitUIWidgets() {
@@ -109,36 +244,56 @@ void AInvadersGameMode::InitUIWidgets() {
     GameOverWidget = CreateWidget(World, GameOverWidgetClass);
     PauseMenuWidget = CreateWidget(World, PauseMenuWidgetClass);
     TutorialMenuWidget = CreateWidget(World, TutorialMenuWidgetClass);
+    if (HudWidgetClass) {
+        HudWidget = CreateWidget<UInvadersHudWidget>(World, HudWidgetClass);
+    }
 
-    UButton* StartGameButton =
+    StartGameButton =
         Cast<UButton>(MainMenuWidget->GetWidgetFromName("StartGameBtn"));
-    UButton* ExitGameButton =
+    MainMenuExitButton =
         Cast<UButton>(MainMenuWidget->GetWidgetFromName("ExitGameBtn"));
 
     UButton* GameOverRestartButton =
         Cast<UButton>(GameOverWidget->GetWidgetFromName("RestartBtn"));
-    UButton* GameOverExitButton =
+    GameOverExitButton =
         Cast<UButton>(GameOverWidget->GetWidgetFromName("ExitBtn"));
 
-    UButton* PauseRestartButton =
+    PauseRestartButton =
         Cast<UButton>(PauseMenuWidget->GetWidgetFromName("RestartBtn"));
     UButton* PauseExitGameButton =
         Cast<UButton>(PauseMenuWidget->GetWidgetFromName("ExitBtn"));
 
     check(StartGameButton);
-    check(ExitGameButton);
+    check(MainMenuExitButton);
     check(GameOverRestartButton);
     check(GameOverExitButton);
     check(PauseRestartButton);
-    check(ExitGameButton);
+    check(PauseExitGameButton);
+
+    StartGameLabel = Cast<UTextBlock>(StartGameButton->GetContent());
+    if (StartGameLabel) {
+        StartGameText = StartGameLabel->GetText();
+    }
+    MainMenuHiScoreText =
+        Cast<UTextBlock>(MainMenuWidget->GetWidgetFromName("HiScoreTxt"));
+    GameOverHiScoreText =
+        Cast<UTextBlock>(GameOverWidget->GetWidgetFromName("HiScoreTxt"));
+    GameOverScoreText =
+        Cast<UTextBlock>(GameOverWidget->GetWidgetFromName("ScoreTxt"));
+    PauseHiScoreText =
+        Cast<UTextBlock>(PauseMenuWidget->GetWidgetFromName("HiScoreTxt"));
+    PauseScoreText =
+        Cast<UTextBlock>(PauseMenuWidget->GetWidgetFromName("ScoreTxt"));
 
     StartGameButton->OnClicked.AddDynamic(this,
                                           &AInvadersGameMode::ShowTutorialMenu);
     StartGameButton->OnPressed.AddDynamic(this,
                                           &AInvadersGameMode::ShowTutorialMenu);
 
-    ExitGameButton->OnClicked.AddDynamic(this, &AInvadersGameMode::QuitGame);
-    ExitGameButton->OnPressed.AddDynamic(this, &AInvadersGameMode::QuitGame);
+    MainMenuExitButton->OnClicked.AddDynamic(this,
+                                             &AInvadersGameMode::QuitGame);
+    MainMenuExitButton->OnPressed.AddDynamic(this,
+                                             &AInvadersGameMode::QuitGame);
 
     GameOverRestartButton->OnClicked.AddDynamic(
         this, &AInvadersGameMode::RestartInvadersGame);
@@ -159,107 +314,403 @@ void AInvadersGameMode::InitUIWidgets() {
                                               &AInvadersGameMode::ShowMainMenu);
 }
 
-void AInvadersGameMode::InitGameObjects() {
-    UWorld* World = GetWorld();
+void AInvadersGameMode::InitSimulation() {
+    check(EnemyDefs.Num() > 2);
 
-    check(PlayerDef.ShipClass);
+    check(PlayerDef.SpawnPoint);
+    check(AsteroidDef.SpawnPoint);
+    check(EnemySpawnPoint);
+    check(UfoSpawnPoint);
 
-    check(PlayerBulletDef.BulletClass);
-    check(EnemyBulletDef.BulletClass);
-    check(AsteroidDef.AsteroidClass);
+    check(GameCamera);
+    check(MainMenuCamera);
 
-    check(EnemyDefs.Num() > 2);
+    Sim.Init(MakeSimConfig());
+    StepRate = Rules.SimRate;
+    CosmeticRandom.Initialize(HashCombine(Sim.Config.Seed, 1));
+    UE_LOG(LogTemp, Log, TEXT("Session seed %d"), Sim.Config.Seed);
 
-    for (int Idx = 0; Idx < EnemyDefs.Num(); Idx++) {
-        FEnemyDef& E = EnemyDefs[Idx];
-        check(E.ShipClass);
-        check(E.ShipRTClass);
+    PlayerZ = PlayerDef.SpawnPoint->GetActorLocation().Z;
+    EnemyZ = EnemySpawnPoint->GetActorLocation().Z;
+    UfoZ = UfoSpawnPoint->GetActorLocation().Z;
+}
+
+void AInvadersGameMode::LoadGameClasses() {
+    check(!PlayerDef.ShipClass.IsNull());
+    check(!PlayerBulletDef.BulletClass.IsNull());
+    check(!EnemyBulletDef.BulletClass.IsNull());
+    check(!AsteroidDef.AsteroidClass.IsNull());
+    for (const FEnemyDef& Def : EnemyDefs) {
+        check(!Def.ShipClass.IsNull());
+        check(!Def.ShipRTClass.IsNull());
+    }
+
+    FStreamableManager& Streamable = UAssetManager::GetStreamableManager();
+
+    // Menu ships first, they are on screen while the rest streams in.
+    // Benchmarks have no menu, and their previews would capture the
+    // scene on headless machines.
+    if (!Benchmark) {
+        TArray<FSoftObjectPath> MenuPaths;
+        for (const FEnemyDef& Def : EnemyDefs) {
+            MenuPaths.Add(Def.ShipRTClass.ToSoftObjectPath());
+        }
+        MenuClassesHandle = Streamable.RequestAsyncLoad(
+            MenuPaths,
+            FStreamableDelegate::CreateUObject(
+                this, &AInvadersGameMode::InitMenuShips),
+            FStreamableManager::AsyncLoadHighPriority);
+    }
+
+    // Gameplay classes in the order a level needs them, the ufo comes last
+    TArray<FSoftObjectPath> GamePaths;
+    GamePaths.Add(PlayerDef.ShipClass.ToSoftObjectPath());
+    GamePaths.Add(PlayerBulletDef.BulletClass.ToSoftObjectPath());
+    for (int Idx = 0; Idx < EnemyDefs.Num() - 1; Idx++) {
+        GamePaths.Add(EnemyDefs[Idx].ShipClass.ToSoftObjectPath());
+    }
+    GamePaths.Add(EnemyBulletDef.BulletClass.ToSoftObjectPath());
+    GamePaths.Add(AsteroidDef.AsteroidClass.ToSoftObjectPath());
+    GamePaths.Add(EnemyDefs.Last().ShipClass.ToSoftObjectPath());
+    GameClassesHandle = Streamable.RequestAsyncLoad(
+        GamePaths,
+        FStreamableDelegate::CreateUObject(
+            this, &AInvadersGameMode::HandleGameClassesLoaded),
+        FStreamableManager::DefaultAsyncLoadPriority);
+}
 
+float AInvadersGameMode::GetLoadProgress() const {
+    return GameClassesHandle ? GameClassesHandle->GetProgress() : 0.f;
+}
+
+void AInvadersGameMode::UpdateLoadProgress() {
+    static const FTextFormat LoadingFormat =
+        NSLOCTEXT("Invaders", "Loading", "loading {0}");
+    if (StartGameLabel) {
+        StartGameLabel->SetText(FText::Format(
+            LoadingFormat, FText::AsPercent(GetLoadProgress())));
+    }
+}
+
+void AInvadersGameMode::InitMenuShips() {
+    for (int Idx = 0; Idx < EnemyDefs.Num(); Idx++) {
         // Spawn render targets
-        AActor* A = World->SpawnActor<AActor>(E.ShipRTClass);
+        AActor* A =
+            GetWorld()->SpawnActor<AActor>(EnemyDefs[Idx].ShipRTClass.Get());
         A->SetActorLocation(FVector(50000, Idx * 1000, -10000));
         A->SetActorRotation(FRotator(0, 0, 10));
         EnemyRTShips.Add(A);
+
+        // Captured on demand below instead of every frame
+        TInlineComponentArray<USceneCaptureComponent2D*> Captures(A);
+        for (USceneCaptureComponent2D* Capture : Captures) {
+            Capture->bCaptureEveryFrame = false;
+            Capture->bCaptureOnMovement = false;
+            ShipPreviewCaptures.Add(Capture);
+        }
     }
 
-    check(PlayerDef.SpawnPoint);
-    check(AsteroidDef.SpawnPoint);
-    check(EnemySpawnPoint);
-    check(UfoSpawnPoint);
+    CaptureShipPreviews();
+    if (ShipPreviewCaptureRate > 0.f) {
+        GetWorldTimerManager().SetTimer(
+            ShipPreviewTHandle, this, &AInvadersGameMode::CaptureShipPreviews,
+            1.f / ShipPreviewCaptureRate, true);
+    } else {
+        // The render targets keep the captured image
+        GetWorldTimerManager().SetTimerForNextTick(
+            this, &AInvadersGameMode::HideShipPreviews);
+    }
+}
 
-    check(GameCamera);
-    check(MainMenuCamera);
+void AInvadersGameMode::CaptureShipPreviews() {
+    for (USceneCaptureComponent2D* Capture : ShipPreviewCaptures) {
+        Capture->CaptureSceneDeferred();
+    }
+}
 
-    // Player instancing
-    FVector PlayerPos = PlayerDef.SpawnPoint->GetActorLocation();
+void AInvadersGameMode::HideShipPreviews() {
+    for (USceneCaptureComponent2D* Capture : ShipPreviewCaptures) {
+        Capture->SetComponentTickEnabled(false);
+        Capture->Deactivate();
+    }
+    for (AActor* Ship : EnemyRTShips) {
+        Ship->SetActorHiddenInGame(true);
+        Ship->SetActorTickEnabled(false);
+    }
+}
+
+void AInvadersGameMode::HandleGameClassesLoaded() {
+    // Benchmarks wait for the handle and call this directly
+    if (IsGameReady()) {
+        return;
+    }
+    InitGameObjects();
+    UE_LOG(LogTemp, Log, TEXT("Game classes loaded %.2fs after startup"),
+           FPlatformTime::Seconds() - GStartTime);
+
+    if (Benchmark) {
+        StartBenchmark();
+        return;
+    }
+    GetWorldTimerManager().ClearTimer(LoadProgressTHandle);
+    if (StartGameLabel) {
+        StartGameLabel->SetText(StartGameText);
+    }
+    if (!ReplayPath.IsEmpty()) {
+        RestartInvadersGame();
+    } else if (MainMenuWidget->IsInViewport()) {
+        StartGameButton->SetIsEnabled(true);
+        StartGameButton->SetUserFocus(GetWorld()->GetFirstPlayerController());
+    }
+}
+
+void AInvadersGameMode::InitGameObjects() {
+    UWorld* World = GetWorld();
 
-    PlayerShip = World->SpawnActor<AActor>(PlayerDef.ShipClass);
-    PlayerShip->Tags.Add("IsPlayer");
+    // Player instancing
+    PlayerShip = SpawnUnit(PlayerDef.ShipClass.Get());
+    SetEntityId(PlayerShip, MakeEntityId(EInvadersUnit::Player, 0, 0));
 
     // Enemy instancing
     EnemyShipGroup = World->SpawnActor(AActor::StaticClass());
     EnemyShipGroup->SetRootComponent(
         NewObject<USceneComponent>(EnemyShipGroup, TEXT("RootComponent")));
-    int RowWidth = Rules.EnemySpread * Rules.EnemiesInRow;
-    float Types = EnemyDefs.Num() - 1;
-    for (float Idx = 0; Idx < InvadersGameState.TotalEnemyNum; Idx++) {
-        float Col = 0;
-        float Row = FMath::Modf(Idx / Rules.EnemiesInRow, &Col);
-        FVector EnemyLocStart = FVector(RowWidth * Row - RowWidth * 0.5,
-                                        -Rules.EnemySpread * Col, 0);
-
-        FEnemyDef& EDef = EnemyDefs[int(Col) * (Types / Rules.EnemiesInColumn)];
-        AActor* E = World->SpawnActor<AActor>(EDef.ShipClass);
-        E->SetActorLocation(EnemyLocStart);
-        E->AttachToActor(EnemyShipGroup,
-                         FAttachmentTransformRules::KeepRelativeTransform);
-        E->Tags.Add("IsEnemy");
-        EnemyShips.Add(E);
-    };
+    if (Rules.InstancedEnemies) {
+        InitEnemyInstances();
+    } else {
+        for (int Idx = 0; Idx < Sim.State.TotalEnemyNum; Idx++) {
+            FEnemyDef& EDef = EnemyDefs[Sim.EnemyTypes[Idx]];
+            AActor* E = SpawnUnit(EDef.ShipClass.Get());
+            E->SetActorLocation(ToWorld(Sim.EnemyOffsets[Idx], 0));
+            E->AttachToActor(EnemyShipGroup,
+                             FAttachmentTransformRules::KeepRelativeTransform);
+            SetEntityId(E, MakeEntityId(EInvadersUnit::Enemy,
+                                        Sim.EnemyTypes[Idx], Idx));
+            EnemyShips.Add(E);
+        };
+    }
 
     // Last enemy definition reserved for ufo
-    UfoShip = World->SpawnActor<AActor>(EnemyDefs.Top().ShipClass);
-    UfoShip->Tags.Add("IsUfo");
-    UfoShip->Tags.Add("IsEnemy");
+    UfoShip = SpawnUnit(EnemyDefs.Top().ShipClass.Get());
+    SetEntityId(UfoShip, MakeEntityId(EInvadersUnit::Ufo,
+                                      EnemyDefs.Num() - 1, 0));
 
     // Asteroid instancing
-    FVector AsteroidPos = AsteroidDef.SpawnPoint->GetActorLocation();
-    float Spread = Rules.SideMovementAmount * 4.f / 3.f;
-    for (float Idx = 0; Idx < 4; Idx++) {
-        AActor* E = World->SpawnActor<AActor>(AsteroidDef.AsteroidClass);
-        FVector LocPos =
-            FVector(Idx * Spread - Rules.SideMovementAmount * 2, 0, 0);
-        E->SetActorLocation(AsteroidPos + LocPos);
-        E->Tags.Add("IsAsteroid");
-        E->Tags.Add("IsEnemy");
+    float AsteroidZ = AsteroidDef.SpawnPoint->GetActorLocation().Z;
+    for (int Idx = 0; Idx < Sim.AsteroidPositions.Num(); Idx++) {
+        AActor* E = SpawnUnit(AsteroidDef.AsteroidClass.Get());
+        E->SetActorLocation(ToWorld(Sim.AsteroidPositions[Idx], AsteroidZ));
+        SetEntityId(E, MakeEntityId(EInvadersUnit::Asteroid, 0, Idx));
         Asteroids.Add(E);
     }
 
     // Bullet instace pool
-    for (int Idx = 0; Idx < MAX_BULLETS; Idx++) {
-        AActor* Bullet =
-            GetWorld()->SpawnActor<AActor>(EnemyBulletDef.BulletClass);
-        Bullet->SetActorEnableCollision(false);
-        Bullet->SetActorHiddenInGame(true);
+    for (int Idx = 0; Idx < Sim.EnemyBullets.Capacity; Idx++) {
+        AActor* Bullet = SpawnUnit(EnemyBulletDef.BulletClass.Get());
         EnemyBullets.Add(Bullet);
+        EnemyBulletColliders.Add(FindOverlapComponent(Bullet));
+        check(EnemyBulletColliders.Last());
     }
 
-    for (int Idx = 0; Idx < MAX_BULLETS; Idx++) {
-        AActor* Bullet =
-            GetWorld()->SpawnActor<AActor>(PlayerBulletDef.BulletClass);
-        Bullet->SetActorEnableCollision(false);
-        Bullet->SetActorHiddenInGame(true);
+    for (int Idx = 0; Idx < Sim.PlayerBullets.Capacity; Idx++) {
+        AActor* Bullet = SpawnUnit(PlayerBulletDef.BulletClass.Get());
         PlayerBullets.Add(Bullet);
+        PlayerBulletColliders.Add(FindOverlapComponent(Bullet));
+        check(PlayerBulletColliders.Last());
+    }
+    // Spawned visible, the first sync hides them
+    ShownPlayerBullets = PlayerBullets.Num();
+    ShownEnemyBullets = EnemyBullets.Num();
+
+    MeasureUnitExtents();
+
+    InitActorSync();
+    InitRenderHandles();
+    ResetUnitMaterials();
+    SyncActors();
+}
+
+FInvadersSimConfig AInvadersGameMode::MakeSimConfig() const {
+    FInvadersSimConfig Config;
+    Config.EnemiesInRow = Rules.EnemiesInRow;
+    Config.EnemiesInColumn = Rules.EnemiesInColumn;
+    Config.EnemySpread = Rules.EnemySpread;
+    Config.ForwardMovementAmount = Rules.ForwardMovementAmount;
+    Config.SideMovementAmount = Rules.SideMovementAmount;
+    Config.MinSpeedFactor = Rules.MinSpeedFactor;
+    Config.LastRow = Rules.LastRow;
+    Config.UfoAppearTimeMin = Rules.UfoAppearTimeMin;
+    Config.UfoAppearTimeMax = Rules.UfoAppearTimeMax;
+
+    Config.Seed = Rules.Seed;
+    FParse::Value(FCommandLine::Get(), TEXT("InvadersSeed="), Config.Seed);
+    if (Config.Seed == 0) {
+        Config.Seed = int32(FPlatformTime::Cycles());
+    }
+
+    Config.PlayerSpeed = PlayerDef.Speed;
+    Config.PlayerLives = PlayerDef.Lives;
+    Config.PlayerShootInterval = PlayerDef.ShootFrequency;
+    Config.EnemyShootInterval = Rules.EnemyShootFrequency;
+
+    Config.PlayerBulletVelocity = PlayerBulletDef.Velocity;
+    Config.EnemyBulletVelocity = EnemyBulletDef.Velocity;
+    Config.MaxPlayerBullets = PlayerBulletDef.MaxBullets;
+    Config.MaxEnemyBullets = EnemyBulletDef.MaxBullets;
+
+    Config.AsteroidHealth = AsteroidDef.Health;
+
+    Config.EnemyTypeDefs.Reset();
+    for (const FEnemyDef& Def : EnemyDefs) {
+        FInvadersEnemyType Type;
+        Type.Points = Def.Points;
+        Config.EnemyTypeDefs.Add(Type);
+    }
+
+    // Instances have no collision to overlap with
+    Config.AnalyticPlayerHits =
+        Rules.CollisionMode != EInvadersCollisionMode::Overlap ||
+        Rules.InstancedEnemies;
+    Config.AnalyticEnemyHits = IsPhysicsFree();
+
+    Config.PlayerSpawn = FVector2D(PlayerDef.SpawnPoint->GetActorLocation());
+    Config.EnemySpawn = FVector2D(EnemySpawnPoint->GetActorLocation());
+    Config.UfoSpawn = FVector2D(UfoSpawnPoint->GetActorLocation());
+    Config.AsteroidSpawn =
+        FVector2D(AsteroidDef.SpawnPoint->GetActorLocation());
+    return Config;
+}
+
+AActor* AInvadersGameMode::SpawnUnit(UClass* Class) {
+    if (!IsPhysicsFree()) {
+        return GetWorld()->SpawnActor<AActor>(Class);
     }
+    // Collision is off before the components register, so they never
+    // create physics state
+    AActor* Actor =
+        GetWorld()->SpawnActorDeferred<AActor>(Class, FTransform::Identity);
+    Actor->SetActorEnableCollision(false);
+    Actor->FinishSpawning(FTransform::Identity);
+    return Actor;
+}
+
+void AInvadersGameMode::InitEnemyInstances() {
+    const int TypeNum = EnemyDefs.Num() - 1;
+
+    // Take the mesh and the base material from a template actor of each
+    // type, the last definition is reserved for the ufo
+    TArray<FTransform> MeshTransforms;
+    for (int Type = 0; Type < TypeNum; Type++) {
+        AActor* Template = SpawnUnit(EnemyDefs[Type].ShipClass.Get());
+        UStaticMeshComponent* Mesh =
+            Template->FindComponentByClass<UStaticMeshComponent>();
+        check(Mesh);
+
+        UMaterialInterface* Material = Mesh->GetMaterial(0);
+        if (UMaterialInstanceDynamic* Dynamic =
+                Cast<UMaterialInstanceDynamic>(Material)) {
+            Material = Dynamic->Parent;
+        }
 
-    ResetUnits();
+        UInstancedStaticMeshComponent* Instances =
+            NewObject<UInstancedStaticMeshComponent>(EnemyShipGroup);
+        Instances->SetStaticMesh(Mesh->GetStaticMesh());
+        Instances->SetMobility(EComponentMobility::Movable);
+        Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+        Instances->SetupAttachment(EnemyShipGroup->GetRootComponent());
+        Instances->RegisterComponent();
+        Instances->CreateDynamicMaterialInstance(0, Material);
+        EnemyInstances.Add(Instances);
+
+        // Template is spawned at the origin, so the component transform is
+        // relative to the actor
+        MeshTransforms.Add(Mesh->GetComponentTransform());
+        Sim.Config.EnemyTypeDefs[Type].Extent = GetActorExtent(Template);
+
+        Template->Destroy();
+    }
+
+    // Instances start hidden, collapsed to zero scale
+    for (int Idx = 0; Idx < Sim.State.TotalEnemyNum; Idx++) {
+        int Type = Sim.EnemyTypes[Idx];
+        FTransform Transform = MeshTransforms[Type];
+        Transform.AddToTranslation(ToWorld(Sim.EnemyOffsets[Idx], 0));
+        EnemyInstanceTransforms.Add(Transform);
+        EnemyInstanceIdx.Add(EnemyInstances[Type]->AddInstance(
+            ScaledTransform(Transform, 0.f)));
+    }
+    ShownEnemyAlive.Init(false, Sim.State.TotalEnemyNum);
+}
+
+void AInvadersGameMode::InitActorSync() {
+    ActorSync.Reset();
+    ActorSync.ToggleCollision = !IsPhysicsFree();
+    PlayerSyncIdx = ActorSync.Add(PlayerShip);
+    UfoSyncIdx = ActorSync.Add(UfoShip);
+    GroupSyncIdx = ActorSync.Add(EnemyShipGroup);
+
+    EnemySyncIdx = ActorSync.Num();
+    for (AActor* E : EnemyShips) {
+        ActorSync.Add(E);
+    }
+    AsteroidSyncIdx = ActorSync.Num();
+    for (AActor* A : Asteroids) {
+        ActorSync.Add(A);
+    }
+    PlayerBulletSyncIdx = ActorSync.Num();
+    for (AActor* Bullet : PlayerBullets) {
+        ActorSync.Add(Bullet);
+    }
+    EnemyBulletSyncIdx = ActorSync.Num();
+    for (AActor* Bullet : EnemyBullets) {
+        ActorSync.Add(Bullet);
+    }
+}
+
+void AInvadersGameMode::InitRenderHandles() {
+    PlayerHandle =
+        MakeRenderHandle(PlayerShip->FindComponentByClass<UMeshComponent>());
+
+    EnemyHandles.Reset(EnemyShips.Num() + EnemyInstances.Num());
+    for (AActor* E : EnemyShips) {
+        EnemyHandles.Add(
+            MakeRenderHandle(E->FindComponentByClass<UMeshComponent>()));
+    }
+    for (UInstancedStaticMeshComponent* Instances : EnemyInstances) {
+        EnemyHandles.Add(MakeRenderHandle(Instances));
+    }
+
+    AppearParameterInstance = nullptr;
+    if (AppearParameters) {
+        AppearParameterInstance =
+            GetWorld()->GetParameterCollectionInstance(AppearParameters);
+    }
+}
+
+void AInvadersGameMode::MeasureUnitExtents() {
+    // Hit boxes for the analytic collision mode, taken from the colliding
+    // components so that both modes agree on the unit sizes
+    FInvadersSimConfig& Config = Sim.Config;
+    for (int Idx = 0; Idx < EnemyShips.Num(); Idx++) {
+        Config.EnemyTypeDefs[Sim.EnemyTypes[Idx]].Extent =
+            GetActorExtent(EnemyShips[Idx]);
+    }
+    Config.EnemyTypeDefs.Last().Extent = GetActorExtent(UfoShip);
+    Config.AsteroidExtent = GetActorExtent(Asteroids[0]);
+    Config.BulletExtent = GetActorExtent(PlayerBullets[0]);
+    Config.PlayerExtent = GetActorExtent(PlayerShip);
 }
 
 /// UI WIDGET FUNCTIONS ///
 
 void AInvadersGameMode::ShowMainMenu() {
-    InvadersGameState.LevelStarted = false;
-    ResetUnits();
+    ReplayWriter.Close();
+    Sim.State.LevelStarted = false;
+    Sim.ResetUnits();
+    if (IsGameReady()) {
+        ResetUnitMaterials();
+        SyncActors();
+    }
 
     APlayerController* Controller = GetWorld()->GetFirstPlayerController();
 
@@ -267,50 +718,43 @@ void AInvadersGameMode::ShowMainMenu() {
 
     GameOverWidget->RemoveFromParent();
     PauseMenuWidget->RemoveFromParent();
+    if (HudWidget) {
+        HudWidget->RemoveFromParent();
+    }
 
     Controller->SetViewTarget(MainMenuCamera.Get());
 
-    UButton* StartGameButton =
-        Cast<UButton>(MainMenuWidget->GetWidgetFromName("StartGameBtn"));
+    // Enabled and focused once the unit classes have streamed in, the
+    // label shows the progress until then
+    StartGameButton->SetIsEnabled(IsGameReady());
+    if (!IsGameReady()) {
+        UpdateLoadProgress();
+        GetWorldTimerManager().SetTimer(
+            LoadProgressTHandle, this, &AInvadersGameMode::UpdateLoadProgress,
+            0.1f, true);
+    }
 
-    UTextBlock* HiScoreText =
-        Cast<UTextBlock>(MainMenuWidget->GetWidgetFromName("HiScoreTxt"));
-    InvadersGameState.PrevHiScore = InvadersGameState.HiScore;
-    GameUtils::UpdateScoreTexts(InvadersGameState, HiScoreText);
-    GameUtils::EnableUIMenu(Controller, MainMenuWidget, StartGameButton);
+    Sim.State.PrevHiScore = Sim.State.HiScore;
+    GameUtils::UpdateScoreTexts(Sim.State, MainMenuHiScoreText);
+    GameUtils::EnableUIMenu(
+        Controller, MainMenuWidget,
+        IsGameReady() ? StartGameButton : MainMenuExitButton);
 }
 
 void AInvadersGameMode::ShowRestartMenu() {
     APlayerController* Controller = GetWorld()->GetFirstPlayerController();
 
-    UButton* RestartGameButton =
-        Cast<UButton>(GameOverWidget->GetWidgetFromName("ExitBtn"));
-
-    UTextBlock* HiScoreText =
-        Cast<UTextBlock>(GameOverWidget->GetWidgetFromName("HiScoreTxt"));
-
-    UTextBlock* CurScoreText =
-        Cast<UTextBlock>(GameOverWidget->GetWidgetFromName("ScoreTxt"));
-
-    GameUtils::UpdateScoreTexts(InvadersGameState, HiScoreText, CurScoreText);
-    GameUtils::EnableUIMenu(Controller, GameOverWidget, RestartGameButton);
+    GameUtils::UpdateScoreTexts(Sim.State, GameOverHiScoreText,
+                                GameOverScoreText);
+    GameUtils::EnableUIMenu(Controller, GameOverWidget, GameOverExitButton);
 }
 
 void AInvadersGameMode::ShowPauseMenu() {
     APlayerController* Controller = GetWorld()->GetFirstPlayerController();
     InputComponent->ClearBindingValues();
 
-    UButton* RestartGameButton =
-        Cast<UButton>(PauseMenuWidget->GetWidgetFromName("RestartBtn"));
-
-    UTextBlock* HiScoreText =
-        Cast<UTextBlock>(PauseMenuWidget->GetWidgetFromName("HiScoreTxt"));
-
-    UTextBlock* CurScoreText =
-        Cast<UTextBlock>(PauseMenuWidget->GetWidgetFromName("ScoreTxt"));
-
-    GameUtils::UpdateScoreTexts(InvadersGameState, HiScoreText, CurScoreText);
-    GameUtils::EnableUIMenu(Controller, PauseMenuWidget, RestartGameButton);
+    GameUtils::UpdateScoreTexts(Sim.State, PauseHiScoreText, PauseScoreText);
+    GameUtils::EnableUIMenu(Controller, PauseMenuWidget, PauseRestartButton);
 }
 
 void AInvadersGameMode::ShowTutorialMenu() {
@@ -334,39 +778,33 @@ void AInvadersGameMode::ShowTutorialMenu() {
 /// GAME RESTART ///
 
 void AInvadersGameMode::RestartInvadersGame() {
-    GetWorldTimerManager().ClearTimer(EnemyAppearTHandle);
-    GetWorldTimerManager().ClearTimer(PlayerAppearTHandle);
-    GetWorldTimerManager().ClearTimer(EnemyShootTHandle);
-    GetWorldTimerManager().ClearTimer(UfoAppearTHandle);
-    GetWorldTimerManager().ClearTimer(PlayerShootTHandle);
-
-    TutorialMenuWidget->RemoveFromParent();
-    GameOverWidget->RemoveFromParent();
-    PauseMenuWidget->RemoveFromParent();
-
-    InvadersGameState.EnemyProgTime = 0;
-    InvadersGameState.UfoProgTime = 0;
-    InvadersGameState.EnemyAppearAnimTime = 5;
-    InvadersGameState.PlayerAppearAnimTime = 1;
-
-    InvadersGameState.CurrentLives = PlayerDef.Lives;
-    InvadersGameState.LevelStarted = true;
-
-    ResetUnits();
-
-    PlayerShip->SetActorHiddenInGame(false);
-    PlayerShip->SetActorEnableCollision(true);
-
-    GetWorldTimerManager().SetTimer(
-        PlayerAppearTHandle, this, &AInvadersGameMode::SpawnPlayer, 0.5, false);
-
-    GetWorldTimerManager().SetTimer(
-        EnemyAppearTHandle, this, &AInvadersGameMode::SpawnEnemies, 2.0, false);
+    // No widgets in benchmark runs
+    if (!Benchmark) {
+        TutorialMenuWidget->RemoveFromParent();
+        GameOverWidget->RemoveFromParent();
+        PauseMenuWidget->RemoveFromParent();
+        if (HudWidget) {
+            HudWidget->ResetShownValues();
+            HudWidget->AddToViewport();
+        }
+    }
 
-    GetWorldTimerManager().SetTimer(
-        UfoAppearTHandle, this, &AInvadersGameMode::UfoAppearCallback,
-        FMath::RandRange(Rules.UfoAppearTimeMin, Rules.UfoAppearTimeMax),
-        false);
+    // Seeds a replay before the restart draws from the stream
+    BeginInputLog();
+    SessionSeed = Sim.Random.GetCurrentSeed();
+    if (InputSource) {
+        InputSource->Reset();
+    }
+    if (Benchmark) {
+        Sim.Config.Parallel.MaxWorkers = Benchmark->GetWorkers();
+    }
+    Sim.Restart();
+    SimAccumulator = 0.f;
+    if (Benchmark) {
+        Benchmark->BeginGame();
+    }
+    ResetUnitMaterials();
+    SyncActors();
 
     InputComponent->ClearActionBindings();
     InputComponent->BindAxis("MoveLeft");
@@ -390,412 +828,471 @@ void AInvadersGameMode::RestartInvadersGame() {
     SetActorTickEnabled(true);
 }
 
-void AInvadersGameMode::SpawnEnemies() {
-    UE_LOG(LogTemp, Warning, TEXT("Spawn enemies"));
-    ShootingEnemies.Empty();
-    InvadersGameState.EnemyProgTime = 0;
-    InvadersGameState.EnemyAppearAnimTime = 5.f;
-    InvadersGameState.ActiveEnemyNum = InvadersGameState.TotalEnemyNum;
-    UpdateEnemyGroupMovement(0.0f);
-
-    for (int Idx = 0; Idx < InvadersGameState.TotalEnemyNum; Idx++) {
-        AActor* E = EnemyShips[Idx];
-        E->SetActorHiddenInGame(false);
-        E->SetActorEnableCollision(true);
-        if (Idx < Rules.EnemiesInRow) {
-            ShootingEnemies.Add(Idx);
-        }
-    };
-    float NextEmitTime = Rules.EnemyShootFrequency;
-    GetWorldTimerManager().SetTimer(EnemyShootTHandle, this,
-                                    &AInvadersGameMode::EnemyShootTimerCallback,
-                                    NextEmitTime, false);
-}
-
-void AInvadersGameMode::SpawnPlayer() {
-    InvadersGameState.PlayerAppearAnimTime = 5.f;
-    PlayerShip->SetActorHiddenInGame(false);
-    PlayerShip->SetActorEnableCollision(true);
-}
-
 /// GAME UPDATE LOGIC ///
 
 void AInvadersGameMode::Tick(float DeltaSeconds) {
     Super::Tick(DeltaSeconds);
 
-    if (PauseMenuWidget->IsInViewport() || !InvadersGameState.LevelStarted) {
+    FrameExplosions.Reset();
+
+    if (IsGamePaused() || !Sim.State.LevelStarted) {
         return;
     }
 
-    UpdateEnemyAppearAnimation(DeltaSeconds);
-    UpdatePlayerAppearAnimation(DeltaSeconds);
+    PendingInput.MoveLeft = FInvadersInputFrame::QuantizeAxis(
+        InputComponent->GetAxisValue("MoveLeft"));
+    PendingInput.MoveRight = FInvadersInputFrame::QuantizeAxis(
+        InputComponent->GetAxisValue("MoveRight"));
+
+    const float StepTime = 1.f / StepRate;
+    SimAccumulator += DeltaSeconds;
+    int Steps = 0;
+    while (SimAccumulator >= StepTime && Steps < Rules.MaxStepsPerFrame &&
+           Sim.State.LevelStarted) {
+        StepSimulation();
+        SimAccumulator -= StepTime;
+        Steps++;
+    }
+    // Fell behind, drop the backlog instead of catching up next frame. A
+    // restart inside the loop zeroes the accumulator before the last
+    // subtraction, which must not leave a negative blend.
+    SimAccumulator = FMath::Clamp(SimAccumulator, 0.f, StepTime);
 
-    UpdatePlayerMovement(DeltaSeconds);
-    UpdateEnemyGroupMovement(DeltaSeconds);
-    UpdateUfoMovement(DeltaSeconds);
+    SyncActors(SimAccumulator / StepTime);
 
-    UpdatePlayerBullets(DeltaSeconds);
-    UpdateEnemyBullets(DeltaSeconds);
-}
+    SET_DWORD_STAT(STAT_InvadersPlayerBulletNum, Sim.PlayerBullets.Num);
+    SET_DWORD_STAT(STAT_InvadersEnemyBulletNum, Sim.EnemyBullets.Num);
+    SET_DWORD_STAT(STAT_InvadersAliveEnemyNum, Sim.State.ActiveEnemyNum);
 
-void AInvadersGameMode::UpdatePlayerMovement(float DeltaSeconds) {
-    if (PlayerShip->IsHidden()) {
-        return;
+    if (HudWidget) {
+        HudWidget->Update(Sim.State);
     }
-    FVector ShipPos = PlayerShip->GetTargetLocation();
 
-    float PlayerSideMovement = InputComponent->GetAxisValue("MoveRight") -
-                               InputComponent->GetAxisValue("MoveLeft");
+    UpdateAppearAnimations();
+    UpdateAsteroidRotation(DeltaSeconds);
+}
 
-    // Position update
-    PlayerMovement[0] =
-        FMath::Lerp(PlayerMovement[0], PlayerSideMovement, DeltaSeconds * 5.f);
-    ShipPos[0] += PlayerMovement[0] * PlayerDef.Speed * DeltaSeconds;
-    ShipPos[0] = FMath::Clamp(ShipPos[0], -Rules.SideMovementAmount * 2,
-                              Rules.SideMovementAmount * 2);
-    PlayerShip->SetActorLocation(ShipPos);
-    for (int Idx = 0; Idx < Asteroids.Num(); Idx++) {
-        AActor* A = Asteroids[Idx];
-        FRotator Rot = A->GetActorRotation();
-        Rot.Add(0, 0, DeltaSeconds * 100);
+void AInvadersGameMode::StepSimulation() {
+    FInvadersInputFrame Frame;
+    if (!ReadInputFrame(Frame)) {
+        return;
+    }
+    if (Benchmark) {
+        Benchmark->BeginStep();
+    }
+    FInvadersInput Input;
+    Input.SideMovement = Frame.GetSideMovement();
+    Input.ShootPressed = Frame.ShootPressed;
+    Input.ShootReleased = Frame.ShootReleased;
+    Sim.Step(1.f / StepRate, Input);
+
+    // Units have to be at the stepped positions before the overlaps are
+    // queried. With analytic hits only the end of the frame syncs.
+    if (!Sim.Config.AnalyticPlayerHits || !Sim.Config.AnalyticEnemyHits) {
+        SyncActors();
+    }
+    {
+        INVADERS_PHASE_SCOPE(Sim.PhaseTimes, Overlaps);
+        if (!Sim.Config.AnalyticPlayerHits) {
+            ResolvePlayerBulletOverlaps();
+        }
+        if (!Sim.Config.AnalyticEnemyHits) {
+            ResolveEnemyBulletOverlaps();
+        }
+    }
+    {
+        INVADERS_PHASE_SCOPE(Sim.PhaseTimes, Events);
+        HandleSimEvents();
+    }
 
-        A->SetActorRotation(Rot);
+    if (Benchmark) {
+        Benchmark->EndStep(Sim.PlayerBullets.Num + Sim.EnemyBullets.Num);
+        if (Sim.State.CurrentLives == 0 || Benchmark->IsStepLimitReached()) {
+            FinishBenchmarkGame();
+        }
     }
+}
 
-    // Camera update
-    // FVector CamPos = FVector(0, 1000, 150);
-    // FVector LookAt = ShipPos - CamPos;
-    // LookAt.Normalize();
-
-    // GameCamera->SetActorLocationAndRotation(CamPos, LookAt.Rotation());
-}
-
-void AInvadersGameMode::UpdateEnemyGroupMovement(float DeltaSeconds) {
-    // Local side-to-side position is determined by the oscillation algorithm.
-    // Top values are clamped between [-1, 1] so that we have delays before
-    // resuming the side movement. Forward movement happens in-sync with the
-    // side-to-side movement, not oscillated but linearly interpolated. In
-    // addition we amplify and clamp the local forward position so that the
-    // forward movement occurs only when side movement has paused.
-
-    // TODO: Forward movement doesn't quite work yet with different
-    //       OscXYRatio values
-    //       Figure out why if theres time
-
-    float SpeedN = FMath::Pow(
-        1.0 -
-            float(FMath::RoundToFloat(InvadersGameState.ActiveEnemyNum / 10.f) /
-                  5.f),
-        2);
-    float SpeedFact = FMath::Lerp(Rules.MinSpeedFactor, 1.5, SpeedN);
-
-    InvadersGameState.EnemyProgTime += DeltaSeconds * SpeedFact;
-    float OscXYRatio = 2.f;
-    float N = FMath::Fmod(InvadersGameState.EnemyProgTime, 4.0);
-
-    // Oscillate between [-1, 1]
-    float SideDirection = 1.0 - FMath::Abs(N - 2.0);
-    // Offset x local position
-    float RowPosition = (InvadersGameState.EnemyProgTime + 0.5) / 2.f;
-
-    float RowInt = 0.f;
-    float RowFract =
-        FMath::Modf(FMath::Min(RowPosition, Rules.LastRow), &RowInt);
-
-    RowInt = InvadersGameState.CurrentLevel + RowInt;
-
-    FVector GroupPos = EnemySpawnPoint->GetActorLocation();
-
-    GroupPos[0] += Rules.SideMovementAmount *
-                   FMath::Clamp(SideDirection * OscXYRatio, -1.f, 1.f);
-    GroupPos[1] += RowInt * Rules.ForwardMovementAmount +
-                   Rules.ForwardMovementAmount *
-                       FMath::Clamp(RowFract * OscXYRatio, 0.f, 1.f);
-    EnemyShipGroup->SetActorLocation(GroupPos);
-}
-
-void AInvadersGameMode::UpdateUfoMovement(float DeltaSeconds) {
-    if (!UfoShip->IsHidden()) {
-        FVector from = UfoSpawnPoint->GetActorLocation();
-        FVector to = from + FVector(-from[0] * 2, 0, 0);
-
-        InvadersGameState.UfoProgTime += DeltaSeconds;
-        float N = InvadersGameState.UfoProgTime / 5.f;
-        UfoShip->SetActorLocation(FMath::Lerp(from, to, N));
-        if (N >= 1.0) {
-            InvadersGameState.UfoProgTime = 0.f;
-            UfoShip->SetActorHiddenInGame(true);
-            UfoShip->SetActorEnableCollision(false);
-
-            GetWorldTimerManager().SetTimer(
-                UfoAppearTHandle, this, &AInvadersGameMode::UfoAppearCallback,
-                FMath::RandRange(Rules.UfoAppearTimeMin,
-                                 Rules.UfoAppearTimeMax),
-                false);
+void AInvadersGameMode::BeginInputLog() {
+    ReplayWriter.Close();
+    PendingInput = FInvadersInputFrame();
+    StepRate = Rules.SimRate;
+
+    FInvadersReplayHeader Header;
+    if (!ReplayPath.IsEmpty()) {
+        IsReplaying = ReplayReader.Open(ReplayPath, Header);
+        if (IsReplaying && Header.SimRate < 1.f) {
+            UE_LOG(LogTemp, Error, TEXT("Replay %s has no step rate"),
+                   *ReplayPath);
+            ReplayReader.Close();
+            IsReplaying = false;
         }
+        if (IsReplaying) {
+            UE_LOG(LogTemp, Log, TEXT("Playing replay %s"), *ReplayPath);
+            // Steps of another length would desync, so the replay steps
+            // at the rate it was recorded at
+            if (Header.SimRate != Rules.SimRate) {
+                UE_LOG(LogTemp, Log,
+                       TEXT("Replay recorded at %.0f Hz, stepping at it "
+                            "instead of %.0f Hz"),
+                       Header.SimRate, Rules.SimRate);
+            }
+            StepRate = Header.SimRate;
+            Sim.Random.Initialize(Header.Seed);
+            return;
+        }
+        ReplayPath.Empty();
+    }
+    if ((Benchmark && !Benchmark->RecordReplays) || MaxReplays <= 0) {
+        return;
     }
+
+    Header.Seed = Sim.Random.GetCurrentSeed();
+    Header.SimRate = Rules.SimRate;
+    FString Dir = FPaths::ProjectSavedDir() / TEXT("Replays");
+    FInvadersReplayWriter::PruneDirectory(Dir, MaxReplays - 1);
+    FString Name = FString::Printf(
+        TEXT("%s-%d.invreplay"),
+        *FDateTime::Now().ToString(TEXT("%Y.%m.%d-%H.%M.%S.%s")),
+        RecordedReplays++);
+    ReplayWriter.Open(Dir / Name, Header);
 }
 
-void AInvadersGameMode::UpdatePlayerBullets(float DeltaSeconds) {
-    int BulletNum = InvadersGameState.ActivePlayerBullets;
+bool AInvadersGameMode::ReadInputFrame(FInvadersInputFrame& OutFrame) {
+    if (IsReplaying) {
+        if (!ReplayReader.Read(OutFrame)) {
+            EndReplay();
+            return false;
+        }
+        return true;
+    }
+    if (InputSource) {
+        OutFrame = InputSource->MakeInput(Sim);
+        // Pausing still works from the bindings
+        OutFrame.EscapePressed = PendingInput.EscapePressed;
+    } else {
+        OutFrame = PendingInput;
+    }
+    PendingInput.ClearEdges();
+    ReplayWriter.Write(OutFrame);
+    return true;
+}
 
-    for (int BulletIdx = 0; BulletIdx < BulletNum; BulletIdx++) {
-        int BulletRIdx = BulletNum - BulletIdx - 1;
-        AActor* BulletActor = PlayerBullets[BulletRIdx];
+void AInvadersGameMode::EndReplay() {
+    UE_LOG(LogTemp, Log, TEXT("Replay %s finished"), *ReplayPath);
+    ReplayReader.Close();
+    IsReplaying = false;
+    if (Benchmark) {
+        // The replay is the workload, the next game plays it again
+        FinishBenchmarkGame();
+        return;
+    }
+    ReplayPath.Empty();
+    ShowMainMenu();
+}
 
-        FVector Pos = BulletActor->GetActorLocation();
-        Pos[1] -= PlayerBulletDef.Velocity * DeltaSeconds;
+/// BENCHMARK ///
+
+void AInvadersGameMode::ApplySwarmRules() {
+    Rules.EnemiesInRow = Benchmark->SwarmEnemiesInRow;
+    Rules.EnemiesInColumn = Benchmark->SwarmEnemiesInColumn;
+    Rules.EnemyShootFrequency = 1.f / Rules.SimRate;
+    PlayerDef.ShootFrequency = 1.f / Rules.SimRate;
+    PlayerBulletDef.MaxBullets = Benchmark->SwarmMaxBullets;
+    EnemyBulletDef.MaxBullets = Benchmark->SwarmMaxBullets;
+    // Five seconds of flight over the default range, some 600 bullets
+    PlayerBulletDef.Velocity = 100.f;
+    EnemyBulletDef.Velocity = 100.f;
+    PlayerDef.Lives = MAX_int32;
+
+    // Keeps thousands of units from turning the run into a scene benchmark
+    Rules.InstancedEnemies = true;
+    Rules.CollisionMode = EInvadersCollisionMode::PhysicsFree;
+}
 
-        BulletActor->SetActorLocation(Pos);
+void AInvadersGameMode::StartBenchmark() {
+    UE_LOG(LogTemp, Log, TEXT("Benchmarking %d games"), Benchmark->Games);
 
-        float BulletDist = Pos[1];
-        bool DeleteBullet = BulletDist < -500.0;
-        bool PlaySound = false;
+    // One simulation step per frame without waiting
+    FApp::SetBenchmarking(true);
+    FApp::SetUseFixedTimeStep(true);
+    FApp::SetFixedDeltaTime(1.0 / Rules.SimRate);
 
-        AActor* UnitActor = nullptr;
+    if (Benchmark->BatchGames > 0) {
+        Benchmark->MeasureBatch(Sim.Config, 1.f / Rules.SimRate);
+    }
+    Sim.PhaseTimes = &Benchmark->PhaseTimes;
+    RestartInvadersGame();
+}
 
-        TArray<AActor*> OverlappedActors;
-        BulletActor->GetOverlappingActors(OverlappedActors);
+void AInvadersGameMode::FinishBenchmarkGame() {
+    Benchmark->MeasureSnapshot(Sim);
+    if (!Benchmark->EndGame(Sim.State)) {
+        RestartInvadersGame();
+        return;
+    }
+    Benchmark->WriteReport();
+    Sim.State.LevelStarted = false;
+    if (Benchmark->CheckAllocations()) {
+        FPlatformMisc::RequestExitWithStatus(false, 1);
+        return;
+    }
+    QuitGame();
+}
 
-        if (OverlappedActors.Num() > 0 &&
-            OverlappedActors[0]->ActorHasTag("IsEnemy")) {
-            DeleteBullet = true;
-            UnitActor = OverlappedActors[0];
+void AInvadersGameMode::PlayExplosion(const FVector2D& Pos) {
+    // A frame never plays more explosions than there are voices, so a
+    // volley can't cut off its own sounds
+    if (FrameExplosions.Num() >= ExplosionVoicePool.Num()) {
+        INC_DWORD_STAT(STAT_InvadersSoundsThrottled);
+        return;
+    }
+    const float MergeDistanceSq = FMath::Square(ExplosionMergeDistance);
+    for (const FVector2D& Played : FrameExplosions) {
+        if (FVector2D::DistSquared(Played, Pos) < MergeDistanceSq) {
+            INC_DWORD_STAT(STAT_InvadersSoundsThrottled);
+            return;
         }
+    }
+    FrameExplosions.Add(Pos);
+
+    // Round robin, the next voice is the one started longest ago
+    UAudioComponent* Voice = ExplosionVoicePool[NextExplosionVoice];
+    NextExplosionVoice = (NextExplosionVoice + 1) % ExplosionVoicePool.Num();
+
+    Voice->Stop();
+    Voice->SetSound(ExplosionSounds[CosmeticRandom.RandRange(
+        0, ExplosionSounds.Num() - 1)]);
+    Voice->SetWorldLocation(ToWorld(Pos, PlayerZ));
+    Voice->SetVolumeMultiplier(CosmeticRandom.FRandRange(0.2, 0.5));
+    Voice->Play();
+    INC_DWORD_STAT(STAT_InvadersSoundsPlayed);
+}
 
-        if (UnitActor) {
-            PlaySound = true;
-            if (UnitActor->ActorHasTag("IsAsteroid")) {
-                int HPIdx = Asteroids.Find(UnitActor);
-                int HP = AsteroidHP[HPIdx];
-                HP--;
-                if (HP <= 0) {
-                    UnitActor->SetActorHiddenInGame(true);
-                    UnitActor->SetActorEnableCollision(false);
-                }
-                AsteroidHP[HPIdx] = HP;
-                DeleteBullet = true;
-                PlaySound = true;
-            } else {
-                UnitActor->SetActorHiddenInGame(true);
-                UnitActor->SetActorEnableCollision(false);
-
-                InvadersGameState.Score += EnemyPointMap[UnitActor->GetClass()];
-
-                if (UnitActor->ActorHasTag("IsUfo")) {
-                    // Reset ufo timer
-                    InvadersGameState.UfoProgTime = 0.f;
-                    GetWorldTimerManager().SetTimer(
-                        UfoAppearTHandle, this,
-                        &AInvadersGameMode::UfoAppearCallback,
-                        FMath::RandRange(Rules.UfoAppearTimeMin,
-                                         Rules.UfoAppearTimeMax),
-                        false);
-                } else {
-                    // Update active enemy num and shooting enemies
-                    InvadersGameState.ActiveEnemyNum--;
-
-                    int EnemyIdx = EnemyShips.Find(UnitActor);
-                    int ShootingIdx = ShootingEnemies.Find(EnemyIdx);
-
-                    // Reorganize shootter enemies (first row)
-                    if (ShootingIdx != INDEX_NONE) {
-                        int NewIdx = ShootingEnemies[ShootingIdx];
-                        ShootingEnemies.RemoveAt(ShootingIdx);
-
-                        NewIdx += Rules.EnemiesInRow;
-                        // Find next visible enemy row by row
-                        while (NewIdx < InvadersGameState.TotalEnemyNum) {
-                            if (!EnemyShips[NewIdx]->IsHidden()) {
-                                ShootingEnemies.Add(NewIdx);
-                                break;
-                            }
-                            NewIdx += Rules.EnemiesInRow;
-                        }
-                    }
-                }
-            }
+void AInvadersGameMode::HandleSimEvents() {
+    const FInvadersSimEvents& Events = Sim.Events;
+
+    // Benchmark runs have no audio
+    if (!Benchmark) {
+        for (const FVector2D& Pos : Events.Explosions) {
+            PlayExplosion(Pos);
         }
-        if (PlaySound) {
-            UGameplayStatics::PlaySoundAtLocation(
-                GetWorld(),
-                ExplosionSounds[FMath::RandRange(0, ExplosionSounds.Num() - 1)],
-                BulletActor->GetActorLocation(), FMath::RandRange(0.2, 0.5));
+    }
+
+    if (Events.WaveCleared) {
+        // Verbose so the step stays free of log formatting
+        UE_LOG(LogTemp, Verbose, TEXT("All enemies killed"));
+    }
+
+    if (Events.PlayerHit) {
+        HandlePlayerHit();
+    }
+}
+
+bool AInvadersGameMode::ResolvePlayerBulletOverlaps() {
+    bool AnyHit = false;
+
+    INC_DWORD_STAT_BY(STAT_InvadersOverlapQueries, Sim.PlayerBullets.Num);
+    for (int Idx = Sim.PlayerBullets.Num - 1; Idx >= 0; Idx--) {
+        uint32 Id = GetOverlapEntityId(PlayerBulletColliders[Idx]);
+        EInvadersUnit Unit = GetEntityUnit(Id);
+        if (!(UnitMask(Unit) & FInvadersSim::PlayerBulletTargets)) {
+            continue;
         }
-        if (DeleteBullet) {
-            AActor* LastBullet =
-                PlayerBullets[InvadersGameState.ActivePlayerBullets - 1];
-            LastBullet->SetActorHiddenInGame(true);
-            LastBullet->SetActorEnableCollision(false);
-            BulletActor->SetActorLocation(LastBullet->GetActorLocation());
-
-            InvadersGameState.ActivePlayerBullets--;
+        AnyHit |= Sim.ResolvePlayerBulletHit(Idx, Unit, GetEntitySlot(Id));
+    }
+    return AnyHit;
+}
+
+bool AInvadersGameMode::ResolveEnemyBulletOverlaps() {
+    bool AnyHit = false;
+
+    INC_DWORD_STAT_BY(STAT_InvadersOverlapQueries, Sim.EnemyBullets.Num);
+    for (int Idx = Sim.EnemyBullets.Num - 1; Idx >= 0; Idx--) {
+        // This could be handled by the collision channels but
+        // I want to keep this as simple as possible.
+        uint32 Id = GetOverlapEntityId(EnemyBulletColliders[Idx]);
+        EInvadersUnit Unit = GetEntityUnit(Id);
+        if (!(UnitMask(Unit) & FInvadersSim::EnemyBulletTargets)) {
+            continue;
         }
+        AnyHit |= Sim.ResolveEnemyBulletHit(Idx, Unit, GetEntitySlot(Id));
+    }
+    return AnyHit;
+}
 
-        // All enemies killed
-        if (!GetWorldTimerManager().IsTimerActive(EnemyAppearTHandle) &&
-            InvadersGameState.ActiveEnemyNum == 0) {
-            UE_LOG(LogTemp, Warning, TEXT("All enemies killed"));
-            InvadersGameState.CurrentLevel++;
-            InvadersGameState.EnemyProgTime = 0;
+/// PRESENTATION ///
 
-            GetWorldTimerManager().SetTimer(EnemyAppearTHandle, this,
-                                            &AInvadersGameMode::SpawnEnemies,
-                                            3.0, false);
-        }
+void AInvadersGameMode::SyncActors(float Alpha) {
+    INVADERS_PHASE_SCOPE(Sim.PhaseTimes, Sync);
+
+    FVector2D PlayerPos =
+        FMath::Lerp(Sim.GetPrevPlayerPos(), Sim.GetPlayerPos(), Alpha);
+    ActorSync.SetVisible(PlayerSyncIdx, Sim.PlayerVisible);
+    ActorSync.SetLocation(PlayerSyncIdx, ToWorld(PlayerPos, PlayerZ));
+
+    FVector2D GroupPos =
+        FMath::Lerp(Sim.GetPrevGroupPos(), Sim.GetGroupPos(), Alpha);
+    ActorSync.SetLocation(GroupSyncIdx, ToWorld(GroupPos, EnemyZ));
+    for (int Idx = 0; Idx < EnemyShips.Num(); Idx++) {
+        ActorSync.SetVisible(EnemySyncIdx + Idx, Sim.EnemyAlive[Idx]);
     }
+    if (Rules.InstancedEnemies) {
+        SyncEnemyInstances();
+    }
+
+    FVector2D UfoPos =
+        FMath::Lerp(Sim.GetPrevUfoPos(), Sim.GetUfoPos(), Alpha);
+    ActorSync.SetVisible(UfoSyncIdx, Sim.UfoVisible);
+    ActorSync.SetLocation(UfoSyncIdx, ToWorld(UfoPos, UfoZ));
+
+    for (int Idx = 0; Idx < Asteroids.Num(); Idx++) {
+        ActorSync.SetVisible(AsteroidSyncIdx + Idx, Sim.AsteroidHP[Idx] > 0);
+    }
+
+    float Rewind = (1.f - Alpha) / StepRate;
+    SyncBulletActors(ActorSync, PlayerBulletSyncIdx, Sim.PlayerBullets,
+                     PlayerZ, Rewind, ShownPlayerBullets);
+    SyncBulletActors(ActorSync, EnemyBulletSyncIdx, Sim.EnemyBullets, EnemyZ,
+                     Rewind, ShownEnemyBullets);
+
+    // Everything above only marked changes, this is the pass that touches
+    // the scene
+    INC_DWORD_STAT_BY(STAT_InvadersActorsSynced, ActorSync.Flush());
 }
-void AInvadersGameMode::UpdateEnemyBullets(float DeltaSeconds) {
-    int BulletNum = InvadersGameState.ActiveEnemyBullets;
-
-    for (int BulletIdx = 0; BulletIdx < BulletNum; BulletIdx++) {
-        int BulletRIdx = BulletNum - BulletIdx - 1;
-        AActor* BulletActor = EnemyBullets[BulletRIdx];
-
-        FVector Pos = BulletActor->GetActorLocation();
-        Pos[1] += EnemyBulletDef.Velocity * DeltaSeconds;
-
-        BulletActor->SetActorLocation(Pos);
-
-        float BulletDist = Pos[1];
-        bool DeleteBullet = BulletDist > 500.0;
-        bool PlaySound = false;
-        TArray<AActor*> OverlappedActors;
-        BulletActor->GetOverlappingActors(OverlappedActors);
-
-        if (OverlappedActors.Num() > 0) {
-            AActor* Actor = OverlappedActors[0];
-
-            // This could be handled by the collision channels but
-            // I want to keep this as simple as possible.
-            if (Actor->ActorHasTag("IsAsteroid")) {
-                int HPIdx = Asteroids.Find(Actor);
-                int HP = AsteroidHP[HPIdx];
-                HP--;
-                if (HP <= 0) {
-                    Actor->SetActorHiddenInGame(true);
-                    Actor->SetActorEnableCollision(false);
-                }
-                AsteroidHP[HPIdx] = HP;
-                DeleteBullet = true;
-                PlaySound = true;
-            } else if (Actor->ActorHasTag("IsPlayer")) {
-                HandlePlayerHit();
-                DeleteBullet = true;
-                PlaySound = true;
-            } else {
-                // Bullet to bullet contact
-            }
+
+void AInvadersGameMode::SyncEnemyInstances() {
+    // Dead enemies are collapsed to zero scale rather than removed, so the
+    // instance indices stay stable across waves
+    TArray<bool, TInlineAllocator<8>> Dirty;
+    Dirty.Init(false, EnemyInstances.Num());
+
+    for (int Idx = 0; Idx < Sim.State.TotalEnemyNum; Idx++) {
+        bool Alive = Sim.EnemyAlive[Idx];
+        if (ShownEnemyAlive[Idx] != Alive) {
+            int Type = Sim.EnemyTypes[Idx];
+            EnemyInstances[Type]->UpdateInstanceTransform(
+                EnemyInstanceIdx[Idx],
+                ScaledTransform(EnemyInstanceTransforms[Idx], Alive ? 1 : 0),
+                false, false, true);
+            ShownEnemyAlive[Idx] = Alive;
+            Dirty[Type] = true;
         }
+    }
 
-        if (PlaySound) {
-            UGameplayStatics::PlaySoundAtLocation(
-                GetWorld(),
-                ExplosionSounds[FMath::RandRange(0, ExplosionSounds.Num() - 1)],
-                BulletActor->GetActorLocation(), FMath::RandRange(0.2, 0.5));
+    for (int Type = 0; Type < EnemyInstances.Num(); Type++) {
+        if (Dirty[Type]) {
+            EnemyInstances[Type]->MarkRenderStateDirty();
         }
+    }
+}
 
-        if (DeleteBullet) {
-            AActor* LastBullet =
-                EnemyBullets[InvadersGameState.ActiveEnemyBullets - 1];
-            LastBullet->SetActorHiddenInGame(true);
-            LastBullet->SetActorEnableCollision(false);
-            BulletActor->SetActorLocation(LastBullet->GetActorLocation());
+void AInvadersGameMode::UpdateAppearAnimations() {
+    float EnemyAnimTime = Sim.State.EnemyAppearAnimTime;
+    if (EnemyAnimTime != ShownEnemyAppearAnimTime) {
+        SetEnemyAppearance(EnemyAnimTime, 1.0 - (EnemyAnimTime - 1.f) / 4);
+        ShownEnemyAppearAnimTime = EnemyAnimTime;
+    }
 
-            InvadersGameState.ActiveEnemyBullets--;
-        }
+    float PlayerAnimTime = Sim.State.PlayerAppearAnimTime;
+    if (PlayerAnimTime != ShownPlayerAppearAnimTime) {
+        SetPlayerAppearance(PlayerAnimTime, 1.0 - (PlayerAnimTime - 1.f) / 4);
+        ShownPlayerAppearAnimTime = PlayerAnimTime;
     }
 }
 
-void AInvadersGameMode::UpdateEnemyAppearAnimation(float DeltaSeconds) {
-    if (InvadersGameState.EnemyAppearAnimTime > 1) {
-        for (AActor* E : EnemyShips) {
-            if (!E->IsHidden()) {
-                TArray<UActorComponent*> MeshComponents;
-                E->GetComponents(UMeshComponent::StaticClass(), MeshComponents);
-                const UMeshComponent* Mesh =
-                    Cast<UMeshComponent>(MeshComponents[0]);
-                UMaterialInstanceDynamic* Material =
-                    Cast<UMaterialInstanceDynamic>(Mesh->GetMaterial(0));
-                if (Material) {
-                    Material->SetScalarParameterValue(
-                        "Gamma", InvadersGameState.EnemyAppearAnimTime);
-                    float OpacityN =
-                        (InvadersGameState.EnemyAppearAnimTime - 1.f) / 4;
-                    Material->SetScalarParameterValue("Opacity",
-                                                      1.0 - OpacityN);
-                }
-            }
+void AInvadersGameMode::SetEnemyAppearance(float Gamma, float Opacity) {
+    if (AppearParameterInstance) {
+        AppearParameterInstance->SetScalarParameterValue("EnemyGamma", Gamma);
+        AppearParameterInstance->SetScalarParameterValue("EnemyOpacity",
+                                                         Opacity);
+        return;
+    }
+
+    // Per slot handles only need updating for the alive enemies
+    bool PerSlot = !Rules.InstancedEnemies;
+    for (int Idx = 0; Idx < EnemyHandles.Num(); Idx++) {
+        if (!PerSlot || Sim.EnemyAlive[Idx]) {
+            SetAppearMaterial(EnemyHandles[Idx], Gamma, Opacity);
         }
-        InvadersGameState.EnemyAppearAnimTime =
-            fmax(1, InvadersGameState.EnemyAppearAnimTime - DeltaSeconds * 8.f);
-    }
-}
-
-void AInvadersGameMode::UpdatePlayerAppearAnimation(float DeltaSeconds) {
-    if (InvadersGameState.PlayerAppearAnimTime > 1) {
-        TArray<UActorComponent*> MeshComponents;
-        PlayerShip->GetComponents(UMeshComponent::StaticClass(),
-                                  MeshComponents);
-        const UMeshComponent* Mesh = Cast<UMeshComponent>(MeshComponents[0]);
-        UMaterialInstanceDynamic* Material =
-            Cast<UMaterialInstanceDynamic>(Mesh->GetMaterial(0));
-        if (Material) {
-            Material->SetScalarParameterValue(
-                "Gamma", InvadersGameState.PlayerAppearAnimTime);
-            float OpacityN = (InvadersGameState.PlayerAppearAnimTime - 1.f) / 4;
-            Material->SetScalarParameterValue("Opacity", 1.0 - OpacityN);
+    }
+}
+
+void AInvadersGameMode::SetPlayerAppearance(float Gamma, float Opacity) {
+    if (AppearParameterInstance) {
+        AppearParameterInstance->SetScalarParameterValue("PlayerGamma", Gamma);
+        AppearParameterInstance->SetScalarParameterValue("PlayerOpacity",
+                                                         Opacity);
+        return;
+    }
+    SetAppearMaterial(PlayerHandle, Gamma, Opacity);
+}
+
+void AInvadersGameMode::UpdateAsteroidRotation(float DeltaSeconds) {
+    if (!Sim.PlayerVisible) {
+        return;
+    }
+    for (int Idx = 0; Idx < Asteroids.Num(); Idx++) {
+        AActor* A = Asteroids[Idx];
+        FRotator Rot = A->GetActorRotation();
+        Rot.Add(0, 0, DeltaSeconds * 100);
+
+        A->SetActorRotation(Rot);
+    }
+}
+
+void AInvadersGameMode::ResetUnitMaterials() {
+    SetPlayerAppearance(10, 0);
+
+    // Dead enemies included, they fade in from this state on the next wave
+    if (AppearParameterInstance) {
+        SetEnemyAppearance(10, 0);
+    } else {
+        for (const FUnitRenderHandle& Handle : EnemyHandles) {
+            SetAppearMaterial(Handle, 10, 0);
         }
-        InvadersGameState.PlayerAppearAnimTime = fmax(
-            1, InvadersGameState.PlayerAppearAnimTime - DeltaSeconds * 8.f);
     }
+    ShownEnemyAppearAnimTime = Sim.State.EnemyAppearAnimTime;
+    ShownPlayerAppearAnimTime = Sim.State.PlayerAppearAnimTime;
 }
 
 /// HANDLE AND CALLBACK FUNCTIONS///
 
 void AInvadersGameMode::HandlePlayerShootPressed() {
-    if (!PlayerShip->IsHidden()) {
-        this->IsPlayerShooting = true;
-    }
-    if (!GetWorldTimerManager().IsTimerActive(PlayerShootTHandle)) {
-        GetWorldTimerManager().SetTimer(
-            PlayerShootTHandle, this,
-            &AInvadersGameMode::PlayerShootTimerCallback,
-            PlayerDef.ShootFrequency, true);
-        PlayerShootTimerCallback();
-    }
+    // Applied by the next simulation step so recordings see it too
+    PendingInput.ShootPressed = true;
 }
 
 void AInvadersGameMode::HandlePlayerShootReleased() {
-    if (!PlayerShip->IsHidden()) {
-        this->IsPlayerShooting = false;
-    }
+    PendingInput.ShootReleased = true;
 }
 
 void AInvadersGameMode::HandlePlayerHit() {
-    InvadersGameState.CurrentLives--;
-
-    IsPlayerShooting = false;
-    GetWorldTimerManager().ClearTimer(PlayerShootTHandle);
-    PlayerShip->SetActorHiddenInGame(true);
-    PlayerShip->SetActorEnableCollision(false);
-    if (InvadersGameState.CurrentLives == 0) {
+    // The simulation respawns the player while lives are left
+    if (Sim.State.CurrentLives == 0) {
+        ReplayWriter.Close();
+        if (Benchmark) {
+            // Ended after the step by the benchmark
+            return;
+        }
+        if (IsReplaying) {
+            // The recorded session already saved its score, and the end of
+            // the replay returns to the main menu
+            return;
+        }
         SaveHiScore();
         DisableInput(GetWorld()->GetFirstPlayerController());
         ShowRestartMenu();
-
-    } else {
-        FVector PlayerPos = PlayerDef.SpawnPoint->GetActorLocation();
-        PlayerShip->SetActorLocation(PlayerPos);
-
-        GetWorldTimerManager().SetTimer(PlayerAppearTHandle, this,
-                                        &AInvadersGameMode::SpawnPlayer, 1.0,
-                                        false);
     }
 }
 
+bool AInvadersGameMode::IsGamePaused() const {
+    return PauseMenuWidget && PauseMenuWidget->IsInViewport();
+}
+
 void AInvadersGameMode::HandleTogglePausePressed() {
-    if (!PauseMenuWidget->IsInViewport()) {
+    PendingInput.EscapePressed = true;
+    if (!IsGamePaused()) {
         PauseGame();
         ShowPauseMenu();
     } else {
@@ -804,51 +1301,6 @@ void AInvadersGameMode::HandleTogglePausePressed() {
     }
 }
 
-void AInvadersGameMode::EnemyShootTimerCallback() {
-    if (!PauseMenuWidget->IsInViewport()) {
-        if (ShootingEnemies.Num() == 0) {
-            return;
-        }
-        if (InvadersGameState.ActiveEnemyBullets < MAX_BULLETS) {
-            AActor* EnemyActor = EnemyShips[ShootingEnemies[FMath::RandRange(
-                0, ShootingEnemies.Num() - 1)]];
-            FVector EnemyPos = EnemyActor->GetActorLocation();
-            AActor* Bullet = EnemyBullets[InvadersGameState.ActiveEnemyBullets];
-            Bullet->SetActorLocation(EnemyPos);
-            Bullet->SetActorEnableCollision(true);
-            Bullet->SetActorHiddenInGame(false);
-            InvadersGameState.ActiveEnemyBullets++;
-        }
-        float NextEmitTime = Rules.EnemyShootFrequency;
-        GetWorldTimerManager().SetTimer(
-            EnemyShootTHandle, this,
-            &AInvadersGameMode::EnemyShootTimerCallback, NextEmitTime, false);
-    }
-}
-
-void AInvadersGameMode::PlayerShootTimerCallback() {
-    if (!PauseMenuWidget->IsInViewport()) {
-        if (!IsPlayerShooting) {
-            GetWorldTimerManager().ClearTimer(PlayerShootTHandle);
-        } else {
-            if (InvadersGameState.ActivePlayerBullets < MAX_BULLETS) {
-                AActor* Bullet =
-                    PlayerBullets[InvadersGameState.ActivePlayerBullets];
-                Bullet->SetActorLocation(PlayerShip->GetActorLocation());
-                Bullet->SetActorEnableCollision(true);
-                Bullet->SetActorHiddenInGame(false);
-                InvadersGameState.ActivePlayerBullets++;
-            }
-        }
-    }
-}
-
-void AInvadersGameMode::UfoAppearCallback() {
-    UfoShip->SetActorHiddenInGame(false);
-    UfoShip->SetActorEnableCollision(true);
-    UpdateUfoMovement(0.f);
-}
-
 void AInvadersGameMode::StartLevelCallback() {
     TutorialMenuWidget->RemoveFromParent();
 
@@ -863,68 +1315,6 @@ AActor* AInvadersGameMode::EmitBullet(TSubclassOf<AActor> BulletClass,
     return Bullet;
 }
 
-void AInvadersGameMode::ResetUnits() {
-    FVector PlayerPos = PlayerDef.SpawnPoint->GetActorLocation();
-
-    TArray<UActorComponent*> MeshComponents;
-
-    PlayerShip->SetActorLocation(PlayerPos);
-    PlayerShip->SetActorHiddenInGame(true);
-    PlayerShip->SetActorEnableCollision(false);
-
-    PlayerShip->GetComponents(UMeshComponent::StaticClass(), MeshComponents);
-    const UMeshComponent* PMesh = Cast<UMeshComponent>(MeshComponents[0]);
-    UMaterialInstanceDynamic* PMaterial =
-        Cast<UMaterialInstanceDynamic>(PMesh->GetMaterial(0));
-    if (PMaterial) {
-        PMaterial->SetScalarParameterValue("Gamma", 10);
-        PMaterial->SetScalarParameterValue("Opacity", 0);
-    }
-
-    for (float Idx = 0; Idx < InvadersGameState.TotalEnemyNum; Idx++) {
-        AActor* E = EnemyShips[Idx];
-        E->SetActorHiddenInGame(true);
-        E->SetActorEnableCollision(false);
-
-        E->GetComponents(UMeshComponent::StaticClass(), MeshComponents);
-        const UMeshComponent* EMesh = Cast<UMeshComponent>(MeshComponents[0]);
-        UMaterialInstanceDynamic* EMaterial =
-            Cast<UMaterialInstanceDynamic>(EMesh->GetMaterial(0));
-        if (EMaterial) {
-            EMaterial->SetScalarParameterValue("Gamma", 10);
-            EMaterial->SetScalarParameterValue("Opacity", 0);
-        }
-    };
-
-    UpdateEnemyGroupMovement(0.0);
-
-    UfoShip->SetActorHiddenInGame(true);
-    UfoShip->SetActorEnableCollision(false);
-    UpdateUfoMovement(0.0);
-
-    AsteroidHP.Empty();
-    for (float Idx = 0; Idx < Asteroids.Num(); Idx++) {
-        AActor* E = Asteroids[Idx];
-        E->SetActorHiddenInGame(false);
-        E->SetActorEnableCollision(true);
-
-        AsteroidHP.Add(AsteroidDef.Health);
-    }
-
-    for (AActor* B : EnemyBullets) {
-        B->SetActorEnableCollision(false);
-        B->SetActorHiddenInGame(true);
-    }
-
-    for (AActor* B : PlayerBullets) {
-        B->SetActorEnableCollision(false);
-        B->SetActorHiddenInGame(true);
-    }
-
-    InvadersGameState.ActiveEnemyBullets = 0;
-    InvadersGameState.ActivePlayerBullets = 0;
-}
-
 /// PAUSE FUNCTIONS ///
 
 void AInvadersGameMode::PauseGame() {
@@ -935,12 +1325,6 @@ void AInvadersGameMode::PauseGame() {
 
     InputComponent->RemoveActionBinding("Shoot", IE_Pressed);
     InputComponent->RemoveActionBinding("Shoot", IE_Released);
-
-    GetWorldTimerManager().PauseTimer(EnemyAppearTHandle);
-    GetWorldTimerManager().PauseTimer(PlayerAppearTHandle);
-    GetWorldTimerManager().PauseTimer(EnemyShootTHandle);
-    GetWorldTimerManager().PauseTimer(PlayerShootTHandle);
-    GetWorldTimerManager().PauseTimer(UfoAppearTHandle);
 }
 
 void AInvadersGameMode::UnpauseGame() {
@@ -959,34 +1343,73 @@ void AInvadersGameMode::UnpauseGame() {
     Controller->SetViewTarget(GameCamera.Get());
 
     EnableInput(Controller);
-
-    GetWorldTimerManager().UnPauseTimer(EnemyAppearTHandle);
-    GetWorldTimerManager().UnPauseTimer(PlayerAppearTHandle);
-    GetWorldTimerManager().UnPauseTimer(EnemyShootTHandle);
-    GetWorldTimerManager().UnPauseTimer(PlayerShootTHandle);
-    GetWorldTimerManager().UnPauseTimer(UfoAppearTHandle);
 }
 
 /// HISCORE SAVE/LOAD ///
 
+static const TCHAR* SaveSlotName = TEXT("InvadersSaveSlot");
+
+static UInvadersSaveGame* CreateSaveGame() {
+    UInvadersSaveGame* SaveGame = Cast<UInvadersSaveGame>(
+        UGameplayStatics::CreateSaveGameObject(
+            UInvadersSaveGame::StaticClass()));
+    SaveGame->Version = UInvadersSaveGame::LatestVersion;
+    return SaveGame;
+}
+
 void AInvadersGameMode::SaveHiScore() {
-    if (InvadersGameState.Score > InvadersGameState.HiScore) {
-        InvadersGameState.PrevHiScore = InvadersGameState.HiScore;
-        InvadersGameState.HiScore = InvadersGameState.Score;
+    if (Sim.State.Score > Sim.State.HiScore) {
+        Sim.State.PrevHiScore = Sim.State.HiScore;
+        Sim.State.HiScore = Sim.State.Score;
     }
-    if (UInvadersSaveGame* SaveGameInstance =
-            Cast<UInvadersSaveGame>(UGameplayStatics::CreateSaveGameObject(
-                UInvadersSaveGame::StaticClass()))) {
-        SaveGameInstance->HiScore = InvadersGameState.HiScore;
-        UGameplayStatics::SaveGameToSlot(SaveGameInstance, "InvadersSaveSlot",
-                                         0);
+
+    // A game can end before the slot has been read, its entry is merged
+    // into the loaded table then
+    if (!SaveGame) {
+        SaveGame = CreateSaveGame();
+    }
+    FInvadersScoreEntry Entry;
+    Entry.Score = Sim.State.Score;
+    Entry.Level = Sim.State.CurrentLevel;
+    Entry.Duration = Sim.GetTime();
+    Entry.Seed = SessionSeed;
+    if (SaveGame->AddScore(Entry) != INDEX_NONE && IsSaveGameLoaded) {
+        // Serialized here, the file is written on a worker thread
+        UGameplayStatics::AsyncSaveGameToSlot(SaveGame, SaveSlotName, 0);
     }
 }
 
 void AInvadersGameMode::LoadHiScore() {
-    if (UInvadersSaveGame* LoadedGame = Cast<UInvadersSaveGame>(
-            UGameplayStatics::LoadGameFromSlot("InvadersSaveSlot", 0))) {
-        InvadersGameState.HiScore = LoadedGame->HiScore;
-        InvadersGameState.PrevHiScore = LoadedGame->HiScore;
+    UGameplayStatics::AsyncLoadGameFromSlot(
+        SaveSlotName, 0,
+        FAsyncLoadGameFromSlotDelegate::CreateUObject(
+            this, &AInvadersGameMode::HandleHiScoreLoaded));
+}
+
+void AInvadersGameMode::HandleHiScoreLoaded(const FString& SlotName,
+                                            const int32 UserIndex,
+                                            USaveGame* LoadedGame) {
+    IsSaveGameLoaded = true;
+    UInvadersSaveGame* Loaded = Cast<UInvadersSaveGame>(LoadedGame);
+    if (Loaded) {
+        Loaded->Upgrade();
+    } else {
+        Loaded = CreateSaveGame();
+    }
+
+    if (SaveGame && SaveGame->Scores.Num() > 0) {
+        for (const FInvadersScoreEntry& Entry : SaveGame->Scores) {
+            Loaded->AddScore(Entry);
+        }
+        UGameplayStatics::AsyncSaveGameToSlot(Loaded, SaveSlotName, 0);
+    }
+    SaveGame = Loaded;
+
+    Sim.State.HiScore = FMath::Max<int32>(Sim.State.HiScore, Loaded->HiScore);
+    if (!Sim.State.LevelStarted) {
+        Sim.State.PrevHiScore = Sim.State.HiScore;
+    }
+    if (MainMenuWidget && MainMenuWidget->IsInViewport()) {
+        GameUtils::UpdateScoreTexts(Sim.State, MainMenuHiScoreText);
     }
 }
@@ -8,6 +8,7 @@
 #include "Containers/Map.h"
 #include "CoreMinimal.h"
 #include "Engine/GameViewportClient.h"
+#include "Engine/StreamableManager.h"
 #include "GameFramework/GameMode.h"
 #include "Sound/SoundCue.h"
 
@@ -15,40 +16,133 @@
 #include "Engine/TargetPoint.h"
 
 #include "DataTypes.h"
+#include "InvadersActorSync.h"
+#include "InvadersBenchmark.h"
+#include "InvadersHud.h"
+#include "InvadersInputSource.h"
+#include "InvadersReplay.h"
+#include "InvadersSim.h"
 #include "InvadersGameMode.generated.h"
 
 class AGroupActor;
+class UButton;
 class ACameraActor;
+class UInstancedStaticMeshComponent;
+class UMaterialInstanceDynamic;
+class UMaterialParameterCollection;
+class UMaterialParameterCollectionInstance;
+class UMeshComponent;
+class UPrimitiveComponent;
+class USceneCaptureComponent2D;
+class UTextBlock;
+
+// Render handles of a unit, looked up once when the unit is created
+struct FUnitRenderHandle {
+    UMeshComponent* Mesh = nullptr;
+    UMaterialInstanceDynamic* Material = nullptr;
+};
 
 UCLASS()
 class INVADERS_API AInvadersGameMode : public AGameMode {
     GENERATED_BODY()
 
+    FInvadersSim Sim;
+
     AActor* PlayerShip;
     AActor* UfoShip;
     TArray<AActor*> EnemyShips;
     TArray<AActor*> EnemyRTShips;
+    TArray<USceneCaptureComponent2D*> ShipPreviewCaptures;
+    FTimerHandle ShipPreviewTHandle;
     AActor* EnemyShipGroup;
 
-    FVector2D PlayerMovement;
-
-    bool IsPlayerShooting;
-
-    TArray<int> ShootingEnemies;
+    // Instanced formation, one component per enemy type
+    TArray<UInstancedStaticMeshComponent*> EnemyInstances;
+    TArray<FTransform> EnemyInstanceTransforms;
+    TArray<int> EnemyInstanceIdx;
+    TArray<bool> ShownEnemyAlive;
+
+    // Per slot, or per type with instanced enemies
+    TArray<FUnitRenderHandle> EnemyHandles;
+    FUnitRenderHandle PlayerHandle;
+    UMaterialParameterCollectionInstance* AppearParameterInstance;
+
+    // Actor z-planes, the simulation runs on the xy-plane only
+    float PlayerZ;
+    float EnemyZ;
+    float UfoZ;
+
+    // Scene side of SyncActors and where each unit group starts in it
+    FInvadersActorSync ActorSync;
+    int PlayerSyncIdx;
+    int UfoSyncIdx;
+    int GroupSyncIdx;
+    int EnemySyncIdx;
+    int AsteroidSyncIdx;
+    int PlayerBulletSyncIdx;
+    int EnemyBulletSyncIdx;
+
+    float ShownEnemyAppearAnimTime;
+    float ShownPlayerAppearAnimTime;
+
+    // Frame time not yet consumed by fixed simulation steps
+    float SimAccumulator;
+    // Steps per second of the running game, a replay's recorded rate
+    float StepRate;
+
+    // Input edges from the bindings since the last simulation step
+    FInvadersInputFrame PendingInput;
+    // Plays instead of the bindings when set, -InvadersInput=Bot
+    TUniquePtr<IInvadersInputSource> InputSource;
+
+    // Every game is recorded, -InvadersReplay= plays one back instead of
+    // live input
+    FInvadersReplayWriter ReplayWriter;
+    FInvadersReplayReader ReplayReader;
+    FString ReplayPath;
+    bool IsReplaying;
+    // Recordings kept in Saved/Replays, -InvadersMaxReplays=N
+    int MaxReplays = 50;
+    // Games recorded this session, tells apart recordings of the same
+    // millisecond
+    int RecordedReplays = 0;
+
+    // Set for -InvadersBenchmark runs, which skip the UI, audio and menu
+    // ship previews
+    TUniquePtr<FInvadersBenchmark> Benchmark;
+
+    // Random stream for presentation only, kept apart from the gameplay
+    // stream so sounds and effects never change the simulation
+    FRandomStream CosmeticRandom;
+
+    // Preallocated explosion voices, reused oldest first
+    UPROPERTY()
+    TArray<UAudioComponent*> ExplosionVoicePool;
+    int NextExplosionVoice;
+    // Explosions played this frame, nearby duplicates are dropped
+    TArray<FVector2D> FrameExplosions;
 
     TArray<AActor*> PlayerBullets;
     TArray<AActor*> EnemyBullets;
+    // Overlapping bullet components, read without allocating each step
+    TArray<UPrimitiveComponent*> PlayerBulletColliders;
+    TArray<UPrimitiveComponent*> EnemyBulletColliders;
+    // Bullet actors shown by the last sync
+    int ShownPlayerBullets;
+    int ShownEnemyBullets;
 
     TArray<AActor*> Asteroids;
-    TArray<int> AsteroidHP;
 
-    TMap<UClass*, int> EnemyPointMap;
+    // Unit classes streamed in after the main menu is up, the handles
+    // keep them loaded
+    TSharedPtr<FStreamableHandle> MenuClassesHandle;
+    TSharedPtr<FStreamableHandle> GameClassesHandle;
 
-    FTimerHandle EnemyShootTHandle;
-    FTimerHandle PlayerShootTHandle;
-    FTimerHandle UfoAppearTHandle;
-    FTimerHandle EnemyAppearTHandle;
-    FTimerHandle PlayerAppearTHandle;
+    // Score table, not written back until the save slot has been read
+    UPROPERTY()
+    UInvadersSaveGame* SaveGame;
+    bool IsSaveGameLoaded;
+    int32 SessionSeed;
 
     UPROPERTY()
     UUserWidget* GameOverWidget;
@@ -58,6 +152,36 @@ class INVADERS_API AInvadersGameMode : public AGameMode {
     UUserWidget* PauseMenuWidget;
     UPROPERTY()
     UUserWidget* TutorialMenuWidget;
+    UPROPERTY()
+    UInvadersHudWidget* HudWidget;
+
+    // Menu widgets updated on show, looked up once
+    UPROPERTY()
+    UButton* StartGameButton;
+    // Focused instead of the start button until the game is ready
+    UPROPERTY()
+    UButton* MainMenuExitButton;
+    // Shows the load progress until the game is ready, when the start
+    // button's content is a text
+    UPROPERTY()
+    UTextBlock* StartGameLabel;
+    FText StartGameText;
+    FTimerHandle LoadProgressTHandle;
+    // Focused when the game over and pause menus show
+    UPROPERTY()
+    UButton* GameOverExitButton;
+    UPROPERTY()
+    UButton* PauseRestartButton;
+    UPROPERTY()
+    UTextBlock* MainMenuHiScoreText;
+    UPROPERTY()
+    UTextBlock* GameOverHiScoreText;
+    UPROPERTY()
+    UTextBlock* GameOverScoreText;
+    UPROPERTY()
+    UTextBlock* PauseHiScoreText;
+    UPROPERTY()
+    UTextBlock* PauseScoreText;
 
    public:
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Game)
@@ -90,6 +214,12 @@ class INVADERS_API AInvadersGameMode : public AGameMode {
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Game)
     FBulletDef EnemyBulletDef;
 
+    // Optional collection driving the appear fade of all ships with
+    // EnemyGamma, EnemyOpacity, PlayerGamma and PlayerOpacity scalars. Ship
+    // dynamic materials are written directly when not set.
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Game)
+    UMaterialParameterCollection* AppearParameters;
+
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = UI)
     TSubclassOf<UUserWidget> GameOverWidgetClass;
 
@@ -102,6 +232,18 @@ class INVADERS_API AInvadersGameMode : public AGameMode {
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = UI)
     TSubclassOf<UUserWidget> TutorialMenuWidgetClass;
 
+    // Optional in-game score, lives and level display
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = UI)
+    TSubclassOf<UInvadersHudWidget> HudWidgetClass;
+
+    // Captures per second of the menu ship previews. Zero renders each
+    // preview once and then hides the preview ships.
+    UPROPERTY(EditAnywhere,
+              BlueprintReadWrite,
+              Category = UI,
+              meta = (ClampMin = "0"))
+    float ShipPreviewCaptureRate = 0.f;
+
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Audio)
     USoundWave* BgAudioMusic;
 
@@ -111,9 +253,19 @@ class INVADERS_API AInvadersGameMode : public AGameMode {
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Audio)
     TArray<USoundWave*> ExplosionSounds;
 
-   protected:
-    FInvadersGameState InvadersGameState;
+    // Explosions playing at once, a new one cuts off the oldest
+    UPROPERTY(EditAnywhere,
+              BlueprintReadWrite,
+              Category = Audio,
+              meta = (ClampMin = "1"))
+    int ExplosionVoices = 8;
 
+    // Explosions this close to one already played in the same frame are
+    // not played
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Audio)
+    float ExplosionMergeDistance = 50.f;
+
+   protected:
     virtual void InitGame(const FString& MapName,
                           const FString& Options,
                           FString& ErrorMessage) override;
@@ -126,11 +278,33 @@ class INVADERS_API AInvadersGameMode : public AGameMode {
 
     void InitUIWidgets();
 
+    void InitSimulation();
+    void LoadGameClasses();
+    void HandleGameClassesLoaded();
+    void InitMenuShips();
+    void CaptureShipPreviews();
+    void HideShipPreviews();
+
     UFUNCTION()
     void InitGameObjects();
+    void InitEnemyInstances();
+    // Gameplay actor, without collision in the physics-free mode
+    AActor* SpawnUnit(UClass* Class);
+    bool IsPhysicsFree() const {
+        return Rules.CollisionMode == EInvadersCollisionMode::PhysicsFree;
+    }
+
+    // Game objects exist once their classes have been loaded
+    bool IsGameReady() const { return PlayerShip != nullptr; }
+
+    // Unit class loading progress from 0 to 1, for the main menu
+    UFUNCTION(BlueprintPure, Category = Game)
+    float GetLoadProgress() const;
+    void UpdateLoadProgress();
 
     void InitInput();
     void InitSounds();
+    void PlayExplosion(const FVector2D& Pos);
 
     UFUNCTION()
     void ShowMainMenu();
@@ -144,39 +318,55 @@ class INVADERS_API AInvadersGameMode : public AGameMode {
     UFUNCTION()
     void RestartInvadersGame();
 
-    UFUNCTION()
-    void SpawnEnemies();
-
-    UFUNCTION()
-    void SpawnPlayer();
-
-    // Game logic functions
-    void UpdatePlayerMovement(float DeltaSeconds);
-    void UpdateEnemyGroupMovement(float DeltaSeconds);
-    void UpdateUfoMovement(float DeltaSeconds);
-
-    void UpdatePlayerBullets(float DeltaSeconds);
-    void UpdateEnemyBullets(float DeltaSeconds);
-
-    void UpdateEnemyAppearAnimation(float DeltaSeconds);
-    void UpdatePlayerAppearAnimation(float DeltaSeconds);
+    FInvadersSimConfig MakeSimConfig() const;
+    void MeasureUnitExtents();
+
+    void StepSimulation();
+    void BeginInputLog();
+    // False when a replay ran out instead, the game has been ended or
+    // restarted then and must not be stepped
+    bool ReadInputFrame(FInvadersInputFrame& OutFrame);
+    void EndReplay();
+
+    // Swaps in the -BenchmarkSwarm formation, fire rates and bullet pools
+    void ApplySwarmRules();
+    void StartBenchmark();
+    void FinishBenchmarkGame();
+
+    bool IsGamePaused() const;
+
+    // Presentation functions, mirror the simulation state to actors.
+    // Alpha blends from the previous step to the current one.
+    void SyncActors(float Alpha = 1.f);
+    void SyncEnemyInstances();
+    void InitActorSync();
+    void InitRenderHandles();
+    void UpdateAppearAnimations();
+    void SetEnemyAppearance(float Gamma, float Opacity);
+    void SetPlayerAppearance(float Gamma, float Opacity);
+    void UpdateAsteroidRotation(float DeltaSeconds);
+    void ResetUnitMaterials();
+
+    // Engine overlap queries fed back to the simulation
+    bool ResolvePlayerBulletOverlaps();
+    bool ResolveEnemyBulletOverlaps();
+
+    void HandleSimEvents();
 
     void HandlePlayerShootPressed();
     void HandlePlayerShootReleased();
     void HandlePlayerHit();
     void HandleTogglePausePressed();
 
-    void EnemyShootTimerCallback();
-    void PlayerShootTimerCallback();
-    void UfoAppearCallback();
-
     void StartLevelCallback();
 
     AActor* EmitBullet(TSubclassOf<AActor> PlayerShipClass, FVector Pos);
 
-    void ResetUnits();
     void PauseGame();
     void UnpauseGame();
     void SaveHiScore();
     void LoadHiScore();
+    void HandleHiScoreLoaded(const FString& SlotName,
+                             const int32 UserIndex,
+                             USaveGame* LoadedGame);
 };
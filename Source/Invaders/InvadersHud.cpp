@@ -0,0 +1,45 @@
+#include "InvadersHud.h"
+
+#include "Components/TextBlock.h"
+#include "InvadersSim.h"
+#include "Widgets/SInvalidationPanel.h"
+
+void UInvadersHudWidget::NativeOnInitialized() {
+    Super::NativeOnInitialized();
+
+    SmallNumbers.Reset(SmallNumberNum);
+    for (int32 Value = 0; Value < SmallNumberNum; Value++) {
+        SmallNumbers.Add(FText::AsNumber(Value));
+    }
+}
+
+void UInvadersHudWidget::SetSmallNumberText(UTextBlock* Text,
+                                            int32& Shown,
+                                            int32 Value) {
+    if (Text && Shown != Value) {
+        Shown = Value;
+        Text->SetText(SmallNumbers.IsValidIndex(Value)
+                          ? SmallNumbers[Value]
+                          : FText::AsNumber(Value));
+    }
+}
+
+void UInvadersHudWidget::Update(const FInvadersGameState& State) {
+    if (ScoreTxt && ShownScore != State.Score) {
+        ShownScore = State.Score;
+        ScoreText = FText::AsNumber(State.Score);
+        ScoreTxt->SetText(ScoreText);
+    }
+    SetSmallNumberText(LivesTxt, ShownLives, State.CurrentLives);
+    SetSmallNumberText(LevelTxt, ShownLevel, State.CurrentLevel + 1);
+}
+
+void UInvadersHudWidget::ResetShownValues() {
+    ShownScore = INDEX_NONE;
+    ShownLives = INDEX_NONE;
+    ShownLevel = INDEX_NONE;
+}
+
+TSharedRef<SWidget> UInvadersHudWidget::RebuildWidget() {
+    return SNew(SInvalidationPanel)[Super::RebuildWidget()];
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Blueprint/UserWidget.h"
+#include "CoreMinimal.h"
+
+#include "InvadersHud.generated.h"
+
+class UTextBlock;
+struct FInvadersGameState;
+
+// In-game score, lives and level. A text is only set when its value
+// changes, and the widget content sits in an invalidation panel so Slate
+// repaints the cached HUD until one does. Lives and levels come from texts
+// formatted once, a score change formats one new text, which is the only
+// allocation the HUD makes on a kill frame.
+UCLASS()
+class INVADERS_API UInvadersHudWidget : public UUserWidget {
+    GENERATED_BODY()
+
+   public:
+    // Cheap when nothing changed, call every frame
+    void Update(const FInvadersGameState& State);
+    // The next update sets every text
+    void ResetShownValues();
+
+   protected:
+    UPROPERTY(meta = (BindWidget))
+    UTextBlock* ScoreTxt;
+
+    UPROPERTY(meta = (BindWidget))
+    UTextBlock* LivesTxt;
+
+    UPROPERTY(meta = (BindWidgetOptional))
+    UTextBlock* LevelTxt;
+
+    virtual void NativeOnInitialized() override;
+    virtual TSharedRef<SWidget> RebuildWidget() override;
+
+   private:
+    // Texts of the numbers [0, SmallNumberNum)
+    static constexpr int32 SmallNumberNum = 100;
+    TArray<FText> SmallNumbers;
+    // Text of the shown score, rebuilt when the score changes
+    FText ScoreText;
+
+    void SetSmallNumberText(UTextBlock* Text, int32& Shown, int32 Value);
+
+    int32 ShownScore = INDEX_NONE;
+    int32 ShownLives = INDEX_NONE;
+    int32 ShownLevel = INDEX_NONE;
+};
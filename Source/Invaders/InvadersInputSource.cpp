@@ -0,0 +1,133 @@
+#include "InvadersInputSource.h"
+
+#include "InvadersSim.h"
+#include "Math/UnrealMathUtility.h"
+
+TUniquePtr<IInvadersInputSource> IInvadersInputSource::Create(
+    const FString& Name,
+    float StepTime) {
+    if (Name == TEXT("Sweep")) {
+        return MakeUnique<FInvadersSweepInput>();
+    }
+    if (Name == TEXT("Bot")) {
+        return MakeUnique<FInvadersBotInput>(StepTime);
+    }
+    return nullptr;
+}
+
+/// SWEEP ///
+
+FInvadersInputFrame FInvadersSweepInput::MakeInput(const FInvadersSim& Sim) {
+    FInvadersInputFrame Frame;
+    if ((Steps++ / SweepSteps) % 2) {
+        Frame.MoveLeft = 127;
+    } else {
+        Frame.MoveRight = 127;
+    }
+    Frame.ShootPressed = Sim.PlayerVisible && !Sim.PlayerShooting;
+    return Frame;
+}
+
+/// BOT ///
+
+FInvadersInputFrame FInvadersBotInput::MakeInput(const FInvadersSim& Sim) {
+    FInvadersInputFrame Frame;
+    if (!Sim.PlayerVisible) {
+        return Frame;
+    }
+    float TargetX = FindAimX(Sim);
+    float AimX = DodgeAimX(Sim, TargetX);
+    float PlayerX = Sim.GetPlayerPos()[0];
+
+    // Shots are rate limited, so the trigger is only held while lined up
+    bool LinedUp = FMath::Abs(TargetX - PlayerX) <= AimTolerance;
+    Frame.ShootPressed = LinedUp && !Sim.PlayerShooting;
+    Frame.ShootReleased = !LinedUp && Sim.PlayerShooting;
+
+    float Axis = FMath::Clamp((AimX - PlayerX) / SteerDistance, -1.f, 1.f);
+    Frame.MoveRight = FInvadersInputFrame::QuantizeAxis(FMath::Max(Axis, 0.f));
+    Frame.MoveLeft = FInvadersInputFrame::QuantizeAxis(FMath::Max(-Axis, 0.f));
+    return Frame;
+}
+
+float FInvadersBotInput::FindAimX(const FInvadersSim& Sim) const {
+    const FInvadersSimConfig& Config = Sim.Config;
+    const FVector2D PlayerPos = Sim.GetPlayerPos();
+    const float PlayerX = PlayerPos[0];
+    // The formation keeps moving while a shot is on its way
+    const float GroupVelX =
+        (Sim.GetGroupPos()[0] - Sim.GetPrevGroupPos()[0]) / StepTime;
+    const float BulletVel = FMath::Max(Config.PlayerBulletVelocity, 1.f);
+    const float CoverExtent = Config.AsteroidExtent[0] +
+                              Config.BulletExtent[0];
+
+    float BestX = PlayerX;
+    float BestDist = MAX_flt;
+    bool BestCovered = true;
+    for (int Column : Sim.ShootingColumns) {
+        FVector2D Pos = Sim.GetEnemyPos(Sim.ColumnFront[Column]);
+        float FlightTime = FMath::Abs(Pos[1] - PlayerPos[1]) / BulletVel;
+        float X = Pos[0] + GroupVelX * FlightTime;
+
+        bool Covered = false;
+        for (int Idx = 0; Idx < Sim.AsteroidPositions.Num(); Idx++) {
+            Covered |= Sim.AsteroidHP[Idx] > 0 &&
+                       FMath::Abs(X - Sim.AsteroidPositions[Idx][0]) <=
+                           CoverExtent;
+        }
+
+        // Any clear shot beats shooting through an asteroid
+        float Dist = FMath::Abs(X - PlayerX);
+        if (Covered < BestCovered ||
+            (Covered == BestCovered && Dist < BestDist)) {
+            BestX = X;
+            BestDist = Dist;
+            BestCovered = Covered;
+        }
+    }
+    return BestX;
+}
+
+float FInvadersBotInput::DodgeAimX(const FInvadersSim& Sim,
+                                   float AimX) const {
+    const FInvadersSimConfig& Config = Sim.Config;
+    const FVector2D PlayerPos = Sim.GetPlayerPos();
+    const float PlayerX = PlayerPos[0];
+    const float Limit = Config.SideMovementAmount * 2;
+    const float Clearance =
+        Config.PlayerExtent[0] + Config.BulletExtent[0] + DodgeMargin;
+
+    // The soonest bullet over the player decides the dodge, the others
+    // only keep the player from walking under them
+    float SoonestHit = MAX_flt;
+    float DodgeX = AimX;
+    const FInvadersBullets& Bullets = Sim.EnemyBullets;
+    for (int Idx = 0; Idx < Bullets.Num; Idx++) {
+        if (Bullets.VelY[Idx] == 0.f) {
+            continue;
+        }
+        float Time = (PlayerPos[1] - Bullets.PosY[Idx]) / Bullets.VelY[Idx];
+        if (Time < 0.f || Time > DodgeTime) {
+            continue;
+        }
+
+        float Left = Bullets.PosX[Idx] - Clearance;
+        float Right = Bullets.PosX[Idx] + Clearance;
+        if (PlayerX > Left && PlayerX < Right) {
+            if (Time < SoonestHit) {
+                SoonestHit = Time;
+                // Out the nearer side unless it is past the field edge
+                bool GoLeft = PlayerX < Bullets.PosX[Idx];
+                if (GoLeft ? Left < -Limit : Right > Limit) {
+                    GoLeft = !GoLeft;
+                }
+                DodgeX = GoLeft ? Left : Right;
+            }
+        } else if (PlayerX <= Left) {
+            AimX = FMath::Min(AimX, Left);
+        } else {
+            AimX = FMath::Max(AimX, Right);
+        }
+    }
+    return SoonestHit < MAX_flt ? DodgeX : AimX;
+}
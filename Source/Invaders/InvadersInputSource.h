@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InvadersReplay.h"
+#include "Templates/UniquePtr.h"
+
+class FInvadersSim;
+
+// Plays the game in place of the input bindings, asked for one frame per
+// simulation step. Frames go through the replay recording like live input.
+class INVADERS_API IInvadersInputSource {
+   public:
+    virtual ~IInvadersInputSource() = default;
+
+    // Called when a game starts
+    virtual void Reset() {}
+    virtual FInvadersInputFrame MakeInput(const FInvadersSim& Sim) = 0;
+
+    // "Sweep" or "Bot", null for any other name
+    static TUniquePtr<IInvadersInputSource> Create(const FString& Name,
+                                                   float StepTime);
+};
+
+// Sweeps side to side with the trigger held
+class INVADERS_API FInvadersSweepInput : public IInvadersInputSource {
+   public:
+    int SweepSteps = 240;
+
+    virtual void Reset() override { Steps = 0; }
+    virtual FInvadersInputFrame MakeInput(const FInvadersSim& Sim) override;
+
+   private:
+    int Steps = 0;
+};
+
+// Heuristic player. Lines up under the nearest front enemy that no
+// asteroid covers, leading the formation movement, holds the trigger while
+// lined up and steps out from under enemy bullets that would land within
+// DodgeTime. Costs a pass over the enemy bullets, shooting columns and
+// asteroids per step.
+class INVADERS_API FInvadersBotInput : public IInvadersInputSource {
+   public:
+    // Seconds ahead an incoming bullet is dodged
+    float DodgeTime = 1.f;
+    // Extra clearance kept from a bullet's path
+    float DodgeMargin = 40.f;
+    // Distance to the aim point below which the bot eases off the stick
+    float SteerDistance = 20.f;
+    // Distance from the aim point within which the trigger is held
+    float AimTolerance = 8.f;
+
+    explicit FInvadersBotInput(float InStepTime) : StepTime(InStepTime) {}
+
+    virtual FInvadersInputFrame MakeInput(const FInvadersSim& Sim) override;
+
+   private:
+    float StepTime;
+
+    float FindAimX(const FInvadersSim& Sim) const;
+    float DodgeAimX(const FInvadersSim& Sim, float AimX) const;
+};
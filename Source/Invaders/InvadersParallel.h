@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "CoreMinimal.h"
+#include "InvadersAllocCounter.h"
+
+struct FInvadersParallelConfig {
+    // Items per task at least, smaller loops run inline
+    int MinBatch = 256;
+    // Tasks a loop is split into at most, zero for one per worker thread
+    // and the calling thread
+    int MaxWorkers = 0;
+
+    int GetMaxWorkers() const {
+        return MaxWorkers > 0
+                   ? MaxWorkers
+                   : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+    }
+};
+
+// Runs Body(Begin, End) over contiguous ranges covering [0, Num). Every
+// range has to write only its own items, then the result is the same
+// however the ranges were scheduled. Workers count their allocations when
+// the calling thread does.
+template <typename FunctionType>
+void InvadersParallelFor(const FInvadersParallelConfig& Config,
+                         int Num,
+                         FunctionType Body) {
+    int Batches = FMath::Min(FMath::DivideAndRoundUp(Num, Config.MinBatch),
+                             Config.GetMaxWorkers());
+    if (Batches <= 1) {
+        if (Num > 0) {
+            Body(0, Num);
+        }
+        return;
+    }
+    int BatchSize = FMath::DivideAndRoundUp(Num, Batches);
+    const bool Counting = FInvadersAllocCounter::IsThreadCounting();
+    ParallelFor(Batches, [&](int Batch) {
+        FInvadersAllocCountScope CountScope(Counting);
+        int Begin = Batch * BatchSize;
+        Body(Begin, FMath::Min(Begin + BatchSize, Num));
+    });
+}
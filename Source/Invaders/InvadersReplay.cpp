@@ -0,0 +1,176 @@
+#include "InvadersReplay.h"
+
+#include "HAL/FileManager.h"
+#include "Logging/LogMacros.h"
+
+static const uint32 ReplayMagic = 0x52564e49;  // "INVR"
+// Version 2 runs spawns and shooting on simulation time, version 3 moves
+// units in single precision lanes
+static const uint32 ReplayVersion = 3;
+
+// Record field bits, values follow the mask in bit order
+enum : uint8 {
+    FieldMoveLeft = 1 << 0,
+    FieldMoveRight = 1 << 1,
+    FieldShootPressed = 1 << 2,
+    FieldShootReleased = 1 << 3,
+    FieldEscapePressed = 1 << 4,
+    // Trailing record, only carries the held step count
+    FieldEnd = 1 << 7,
+};
+
+/// WRITER ///
+
+bool FInvadersReplayWriter::Open(const FString& Path,
+                                 const FInvadersReplayHeader& Header) {
+    Close();
+    Archive.Reset(IFileManager::Get().CreateFileWriter(*Path));
+    if (!Archive) {
+        UE_LOG(LogTemp, Warning, TEXT("Can't write replay %s"), *Path);
+        return false;
+    }
+
+    uint32 Magic = ReplayMagic;
+    uint32 Version = ReplayVersion;
+    FInvadersReplayHeader Out = Header;
+    *Archive << Magic << Version << Out.Seed << Out.SimRate;
+
+    Last = FInvadersInputFrame();
+    Held = 0;
+    return true;
+}
+
+void FInvadersReplayWriter::Write(const FInvadersInputFrame& Frame) {
+    if (!Archive) {
+        return;
+    }
+
+    uint8 Mask = 0;
+    Mask |= Frame.MoveLeft != Last.MoveLeft ? FieldMoveLeft : 0;
+    Mask |= Frame.MoveRight != Last.MoveRight ? FieldMoveRight : 0;
+    Mask |= Frame.ShootPressed ? FieldShootPressed : 0;
+    Mask |= Frame.ShootReleased ? FieldShootReleased : 0;
+    Mask |= Frame.EscapePressed ? FieldEscapePressed : 0;
+    if (Mask == 0) {
+        Held++;
+        return;
+    }
+
+    FInvadersInputFrame Out = Frame;
+    Archive->SerializeIntPacked(Held);
+    *Archive << Mask;
+    if (Mask & FieldMoveLeft) {
+        *Archive << Out.MoveLeft;
+    }
+    if (Mask & FieldMoveRight) {
+        *Archive << Out.MoveRight;
+    }
+
+    Last = Frame;
+    Held = 0;
+}
+
+void FInvadersReplayWriter::Close() {
+    if (!Archive) {
+        return;
+    }
+    if (Held > 0) {
+        uint8 Mask = FieldEnd;
+        Archive->SerializeIntPacked(Held);
+        *Archive << Mask;
+    }
+    Archive->Close();
+    Archive.Reset();
+}
+
+void FInvadersReplayWriter::PruneDirectory(const FString& Dir, int Keep) {
+    IFileManager& FileManager = IFileManager::Get();
+    TArray<FString> Names;
+    FileManager.FindFiles(Names, *(Dir / TEXT("*.invreplay")), true, false);
+    if (Names.Num() <= Keep) {
+        return;
+    }
+    Names.Sort();
+    for (int Idx = 0; Idx < Names.Num() - Keep; Idx++) {
+        FileManager.Delete(*(Dir / Names[Idx]));
+    }
+}
+
+/// READER ///
+
+bool FInvadersReplayReader::Open(const FString& Path,
+                                 FInvadersReplayHeader& OutHeader) {
+    Close();
+    Archive.Reset(IFileManager::Get().CreateFileReader(*Path));
+    if (!Archive) {
+        UE_LOG(LogTemp, Warning, TEXT("Can't read replay %s"), *Path);
+        return false;
+    }
+
+    uint32 Magic = 0;
+    uint32 Version = 0;
+    *Archive << Magic << Version;
+    if (Magic != ReplayMagic || Version != ReplayVersion) {
+        UE_LOG(LogTemp, Warning, TEXT("%s is not a version %u replay"),
+               *Path, ReplayVersion);
+        Close();
+        return false;
+    }
+    *Archive << OutHeader.Seed << OutHeader.SimRate;
+
+    Current = FInvadersInputFrame();
+    HasPending = false;
+    Held = 0;
+    return true;
+}
+
+bool FInvadersReplayReader::Read(FInvadersInputFrame& OutFrame) {
+    if (!Archive) {
+        return false;
+    }
+
+    // Fetch the next record, it applies after its held steps
+    if (Held == 0 && !HasPending) {
+        if (Archive->AtEnd()) {
+            return false;
+        }
+        uint8 Mask = 0;
+        Archive->SerializeIntPacked(Held);
+        *Archive << Mask;
+
+        Pending = Current;
+        if (Mask & FieldMoveLeft) {
+            *Archive << Pending.MoveLeft;
+        }
+        if (Mask & FieldMoveRight) {
+            *Archive << Pending.MoveRight;
+        }
+        Pending.ShootPressed = Mask & FieldShootPressed;
+        Pending.ShootReleased = Mask & FieldShootReleased;
+        Pending.EscapePressed = Mask & FieldEscapePressed;
+        HasPending = !(Mask & FieldEnd);
+
+        if (Archive->IsError() || (Held == 0 && !HasPending)) {
+            return false;
+        }
+    }
+
+    if (Held > 0) {
+        Held--;
+        OutFrame = Current;
+        return true;
+    }
+
+    OutFrame = Pending;
+    Current = Pending;
+    Current.ClearEdges();
+    HasPending = false;
+    return true;
+}
+
+void FInvadersReplayReader::Close() {
+    if (Archive) {
+        Archive->Close();
+        Archive.Reset();
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/UniquePtr.h"
+
+// Player input of one simulation step. Axes are quantized so that live and
+// replayed sessions feed the simulation identical values.
+struct FInvadersInputFrame {
+    int8 MoveLeft = 0;
+    int8 MoveRight = 0;
+    bool ShootPressed = false;
+    bool ShootReleased = false;
+    bool EscapePressed = false;
+
+    static int8 QuantizeAxis(float Value) {
+        return int8(FMath::RoundToInt(FMath::Clamp(Value, -1.f, 1.f) * 127));
+    }
+
+    float GetSideMovement() const { return (MoveRight - MoveLeft) / 127.f; }
+
+    void ClearEdges() {
+        ShootPressed = false;
+        ShootReleased = false;
+        EscapePressed = false;
+    }
+};
+
+struct FInvadersReplayHeader {
+    // Gameplay random stream state at the start of the recording
+    int32 Seed = 0;
+    float SimRate = 0.f;
+};
+
+// Streams input frames to a file. A record holds only the fields that
+// differ from the previous record, prefixed by the number of steps the
+// previous input was held.
+class INVADERS_API FInvadersReplayWriter {
+   public:
+    bool Open(const FString& Path, const FInvadersReplayHeader& Header);
+    void Write(const FInvadersInputFrame& Frame);
+    void Close();
+
+    bool IsOpen() const { return Archive.IsValid(); }
+
+    // Deletes the oldest replays of the directory until Keep are left.
+    // Replay names start with their date, so name order is age order.
+    static void PruneDirectory(const FString& Dir, int Keep);
+
+   private:
+    TUniquePtr<FArchive> Archive;
+    FInvadersInputFrame Last;
+    uint32 Held = 0;
+};
+
+class INVADERS_API FInvadersReplayReader {
+   public:
+    bool Open(const FString& Path, FInvadersReplayHeader& OutHeader);
+    // Returns false once the recording has run out
+    bool Read(FInvadersInputFrame& OutFrame);
+    void Close();
+
+    bool IsOpen() const { return Archive.IsValid(); }
+
+   private:
+    TUniquePtr<FArchive> Archive;
+    FInvadersInputFrame Current;
+    FInvadersInputFrame Pending;
+    bool HasPending = false;
+    uint32 Held = 0;
+};
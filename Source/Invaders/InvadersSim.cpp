@@ -0,0 +1,755 @@
+#include "InvadersSim.h"
+
+#include "Math/UnrealMathUtility.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+// Bump when the snapshot layout changes
+static constexpr int32 SnapshotVersion = 2;
+
+static bool InBounds(const FVector2D& Delta, const FVector2D& Extent) {
+    return FMath::Abs(Delta[0]) <= Extent[0] &&
+           FMath::Abs(Delta[1]) <= Extent[1];
+}
+
+void FInvadersSim::Init(const FInvadersSimConfig& InConfig) {
+    if (!OwnLanes) {
+        OwnLanes = MakeUnique<FInvadersSimLanes>();
+    }
+    OwnLanes->Init(1, InConfig.MaxPlayerBullets, InConfig.MaxEnemyBullets);
+    Init(InConfig, *OwnLanes, 0);
+}
+
+void FInvadersSim::Init(const FInvadersSimConfig& InConfig,
+                        FInvadersSimLanes& InLanes,
+                        int InLane) {
+    Config = InConfig;
+    Lanes = &InLanes;
+    Lane = InLane;
+    Lanes->Clock[Lane] = 0.0;
+    Random.Initialize(Config.Seed);
+
+    const int EnemyNum = Config.EnemiesInRow * Config.EnemiesInColumn;
+    State = FInvadersGameState();
+    State.TotalEnemyNum = EnemyNum;
+    State.ActiveEnemyNum = EnemyNum;
+    State.CurrentLives = Config.PlayerLives;
+
+    Events.Reset();
+    Events.Explosions.Reserve(Config.MaxPlayerBullets +
+                              Config.MaxEnemyBullets);
+
+    // Formation layout, row 0 is the front row
+    EnemyOffsets.Reset(EnemyNum);
+    EnemyTypes.Reset(EnemyNum);
+    EnemyPoints.Reset(EnemyNum);
+    EnemyAlive.Init(false, EnemyNum);
+
+    ColumnFront.Init(INDEX_NONE, Config.EnemiesInRow);
+    NextInColumn.Init(INDEX_NONE, EnemyNum);
+    PrevInColumn.Init(INDEX_NONE, EnemyNum);
+    ShootingColumns.Reset(Config.EnemiesInRow);
+    ShootingColumnPos.Init(INDEX_NONE, Config.EnemiesInRow);
+
+    int RowWidth = Config.EnemySpread * Config.EnemiesInRow;
+    FormationCell = FVector2D(float(RowWidth) / Config.EnemiesInRow,
+                              Config.EnemySpread);
+    FormationLeft = -RowWidth * 0.5;
+
+    float Types = Config.EnemyTypeDefs.Num() - 1;
+    for (int Idx = 0; Idx < EnemyNum; Idx++) {
+        int Row = Idx / Config.EnemiesInRow;
+        float Column = float(Idx % Config.EnemiesInRow) / Config.EnemiesInRow;
+        EnemyOffsets.Add(FVector2D(RowWidth * Column - RowWidth * 0.5,
+                                   -Config.EnemySpread * Row));
+        EnemyTypes.Add(int(Row * (Types / Config.EnemiesInColumn)));
+        EnemyPoints.Add(Config.EnemyTypeDefs[EnemyTypes.Last()].Points);
+    }
+    UfoPoints = Config.EnemyTypeDefs.Last().Points;
+
+    AsteroidPositions.Reset(Config.AsteroidNum);
+    AsteroidHP.Init(Config.AsteroidHealth, Config.AsteroidNum);
+    float Spread = Config.SideMovementAmount * 4.f / 3.f;
+    for (int Idx = 0; Idx < Config.AsteroidNum; Idx++) {
+        AsteroidPositions.Add(
+            Config.AsteroidSpawn +
+            FVector2D(Idx * Spread - Config.SideMovementAmount * 2, 0));
+    }
+
+    PlayerBullets.Bind(Lanes->PlayerBullets, Lane, Config.MaxPlayerBullets);
+    EnemyBullets.Bind(Lanes->EnemyBullets, Lane, Config.MaxEnemyBullets);
+    PlayerBulletHitUnits.Init(EInvadersUnit::None, Config.MaxPlayerBullets);
+    PlayerBulletHitIdx.Init(INDEX_NONE, Config.MaxPlayerBullets);
+
+    PlayerShooting = false;
+    Timers.Reset();
+    ResetUnits();
+}
+
+void FInvadersSim::Restart() {
+    Lanes->EnemyProgTime[Lane] = 0.f;
+    Lanes->UfoProgTime[Lane] = 0.f;
+    State.EnemyAppearAnimTime = 5;
+    State.PlayerAppearAnimTime = 1;
+
+    State.Score = 0;
+    State.CurrentLevel = 0;
+    State.CurrentLives = Config.PlayerLives;
+    State.LevelStarted = true;
+
+    ResetUnits();
+
+    PlayerVisible = true;
+    PlayerShooting = false;
+
+    Lanes->Clock[Lane] = 0.0;
+    Timers.Reset();
+    SetTimer(EInvadersTimer::SpawnPlayer, 0.5);
+    SetTimer(EInvadersTimer::SpawnEnemies, 2.0);
+    SetTimer(EInvadersTimer::SpawnUfo, NextUfoDelay());
+}
+
+void FInvadersSim::ResetUnits() {
+    Lanes->PlayerX[Lane] = Config.PlayerSpawn[0];
+    Lanes->PlayerMovement[Lane] = 0.f;
+    PlayerVisible = false;
+
+    for (int Idx = 0; Idx < State.TotalEnemyNum; Idx++) {
+        EnemyAlive[Idx] = false;
+    }
+    State.ActiveEnemyNum = 0;
+    for (int Column = 0; Column < Config.EnemiesInRow; Column++) {
+        ColumnFront[Column] = INDEX_NONE;
+        ShootingColumnPos[Column] = INDEX_NONE;
+    }
+    ShootingColumns.Reset();
+    PlaceFormation();
+
+    UfoVisible = false;
+    Lanes->UfoX[Lane] = Config.UfoSpawn[0];
+
+    for (int Idx = 0; Idx < AsteroidHP.Num(); Idx++) {
+        AsteroidHP[Idx] = Config.AsteroidHealth;
+    }
+
+    PlayerBullets.Reset();
+    EnemyBullets.Reset();
+    StorePrevious();
+}
+
+/// STEP ///
+
+void FInvadersSim::Step(float DeltaSeconds, const FInvadersInput& Input) {
+    check(Lanes == OwnLanes.Get());
+    // The vector holding the lane, the others are padding
+    const int Begin = Lane & ~3;
+    const int End = Begin + 4;
+
+    BeginStep(Input);
+    Lanes->Advance(DeltaSeconds, Begin, End);
+    FireTimers(DeltaSeconds);
+    {
+        INVADERS_PHASE_SCOPE(PhaseTimes, PlayerMovement);
+        Lanes->MovePlayers(Config, DeltaSeconds, Begin, End);
+    }
+    {
+        INVADERS_PHASE_SCOPE(PhaseTimes, EnemyMovement);
+        Lanes->MoveFormations(Config, DeltaSeconds, Begin, End);
+    }
+    {
+        INVADERS_PHASE_SCOPE(PhaseTimes, UfoMovement);
+        Lanes->MoveUfos(Config, DeltaSeconds, Begin, End);
+    }
+    {
+        INVADERS_PHASE_SCOPE(PhaseTimes, PlayerBullets);
+        PlayerBullets.Move(DeltaSeconds, Config.BulletRange, Config.Parallel);
+    }
+    {
+        INVADERS_PHASE_SCOPE(PhaseTimes, EnemyBullets);
+        EnemyBullets.Move(DeltaSeconds, Config.BulletRange, Config.Parallel);
+    }
+    EndStep();
+}
+
+void FInvadersSim::BeginStep(const FInvadersInput& Input) {
+    Events.Reset();
+    UpdateShooting(Input);
+    Lanes->SideMovement[Lane] = Input.SideMovement;
+}
+
+void FInvadersSim::FireTimers(float DeltaSeconds) {
+    EInvadersTimer Timer;
+    while (Timers.PopDue(GetTime(), Timer)) {
+        FireTimer(Timer);
+    }
+
+    {
+        INVADERS_PHASE_SCOPE(PhaseTimes, EnemyAppear);
+        UpdateEnemyAppearAnimation(DeltaSeconds);
+    }
+    {
+        INVADERS_PHASE_SCOPE(PhaseTimes, PlayerAppear);
+        UpdatePlayerAppearAnimation(DeltaSeconds);
+    }
+    StageMotion();
+}
+
+void FInvadersSim::EndStep() {
+    UpdateUfoArrival();
+    PlayerBullets.RemoveCulled();
+    EnemyBullets.RemoveCulled();
+    {
+        INVADERS_PHASE_SCOPE(PhaseTimes, Hits);
+        if (Config.AnalyticPlayerHits) {
+            ResolvePlayerBulletHits();
+        }
+        if (Config.AnalyticEnemyHits) {
+            ResolveEnemyBulletHits();
+        }
+    }
+}
+
+void FInvadersSim::StorePrevious() {
+    Lanes->PrevPlayerX[Lane] = Lanes->PlayerX[Lane];
+    Lanes->PrevGroupX[Lane] = Lanes->GroupX[Lane];
+    Lanes->PrevGroupY[Lane] = Lanes->GroupY[Lane];
+    Lanes->PrevUfoX[Lane] = Lanes->UfoX[Lane];
+}
+
+void FInvadersSim::PlaceFormation() {
+    Lanes->EnemyLevel[Lane] = State.CurrentLevel;
+    Lanes->PlaceFormation(Config, Lane);
+}
+
+void FInvadersSim::UpdateShooting(const FInvadersInput& Input) {
+    if (Input.ShootPressed) {
+        if (PlayerVisible) {
+            PlayerShooting = true;
+        }
+        // First shot right away, the timer repeats it while held
+        if (!Timers.IsActive(EInvadersTimer::PlayerShoot)) {
+            FireTimer(EInvadersTimer::PlayerShoot);
+        }
+    }
+    if (Input.ShootReleased && PlayerVisible) {
+        PlayerShooting = false;
+    }
+}
+
+void FInvadersSim::FireTimer(EInvadersTimer Timer) {
+    switch (Timer) {
+        case EInvadersTimer::SpawnPlayer:
+            SpawnPlayer();
+            break;
+        case EInvadersTimer::SpawnEnemies:
+            SpawnEnemies();
+            SetTimer(EInvadersTimer::EnemyShoot, Config.EnemyShootInterval);
+            break;
+        case EInvadersTimer::SpawnUfo:
+            SpawnUfo();
+            break;
+        case EInvadersTimer::EnemyShoot:
+            // Stops with the wave, the next spawn starts it again
+            if (EmitEnemyBullet()) {
+                SetTimer(EInvadersTimer::EnemyShoot,
+                         Config.EnemyShootInterval);
+            }
+            break;
+        case EInvadersTimer::PlayerShoot:
+            if (PlayerShooting) {
+                EmitPlayerBullet();
+                SetTimer(EInvadersTimer::PlayerShoot,
+                         Config.PlayerShootInterval);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void FInvadersSim::UpdateEnemyAppearAnimation(float DeltaSeconds) {
+    if (State.EnemyAppearAnimTime > 1) {
+        State.EnemyAppearAnimTime =
+            fmax(1, State.EnemyAppearAnimTime - DeltaSeconds * 8.f);
+    }
+}
+
+void FInvadersSim::UpdatePlayerAppearAnimation(float DeltaSeconds) {
+    if (State.PlayerAppearAnimTime > 1) {
+        State.PlayerAppearAnimTime =
+            fmax(1, State.PlayerAppearAnimTime - DeltaSeconds * 8.f);
+    }
+}
+
+void FInvadersSim::StageMotion() {
+    Lanes->PlayerMoves[Lane] = PlayerVisible;
+    Lanes->UfoMoves[Lane] = UfoVisible;
+    Lanes->EnemyLevel[Lane] = State.CurrentLevel;
+
+    // Speeds up in fifths of the formation killed, relative to its size so
+    // that larger formations start at the minimum speed too
+    float Alive = 5.f * State.ActiveEnemyNum /
+                  FMath::Max(State.TotalEnemyNum, 1);
+    float SpeedN =
+        FMath::Pow(1.0 - float(FMath::RoundToFloat(Alive) / 5.f), 2);
+    Lanes->EnemySpeed[Lane] =
+        FMath::Lerp(Config.MinSpeedFactor, 1.5, SpeedN);
+}
+
+void FInvadersSim::UpdateUfoArrival() {
+    // Crossed the field in the last kernel pass
+    if (UfoVisible && Lanes->UfoProgTime[Lane] * (1.f / 5.f) >= 1.f) {
+        Lanes->UfoProgTime[Lane] = 0.f;
+        UfoVisible = false;
+        Events.UfoDespawned = true;
+        SetTimer(EInvadersTimer::SpawnUfo, NextUfoDelay());
+    }
+}
+
+void FInvadersSim::ResolvePlayerBulletHits() {
+    // Targets against the state before any hit, the lookups only read
+    InvadersParallelFor(
+        Config.Parallel, PlayerBullets.Num, [&](int Begin, int End) {
+            for (int Idx = Begin; Idx < End; Idx++) {
+                PlayerBulletHitUnits[Idx] = FindPlayerBulletTarget(
+                    PlayerBullets.GetPos(Idx), PlayerBulletHitIdx[Idx]);
+            }
+        });
+
+    // Applied in bullet order. Hits only ever remove targets, so a found
+    // target that is still hittable is the one a serial lookup would find.
+    // Otherwise an earlier bullet took it and the lookup is redone.
+    // Removal swaps in already visited bullets only.
+    for (int Idx = PlayerBullets.Num - 1; Idx >= 0; Idx--) {
+        EInvadersUnit Unit = PlayerBulletHitUnits[Idx];
+        if (Unit == EInvadersUnit::None ||
+            ResolvePlayerBulletHit(Idx, Unit, PlayerBulletHitIdx[Idx])) {
+            continue;
+        }
+        int UnitIdx = INDEX_NONE;
+        Unit = FindPlayerBulletTarget(PlayerBullets.GetPos(Idx), UnitIdx);
+        if (Unit != EInvadersUnit::None) {
+            ResolvePlayerBulletHit(Idx, Unit, UnitIdx);
+        }
+    }
+}
+
+/// COMMANDS ///
+
+void FInvadersSim::ResolveEnemyBulletHits() {
+    // A handful of bullets against a few boxes, not worth the fan out
+    for (int Idx = EnemyBullets.Num - 1; Idx >= 0; Idx--) {
+        int UnitIdx = INDEX_NONE;
+        EInvadersUnit Unit =
+            FindEnemyBulletTarget(EnemyBullets.GetPos(Idx), UnitIdx);
+        if (Unit != EInvadersUnit::None) {
+            ResolveEnemyBulletHit(Idx, Unit, UnitIdx);
+        }
+    }
+}
+
+void FInvadersSim::SpawnEnemies() {
+    Lanes->EnemyProgTime[Lane] = 0.f;
+    State.EnemyAppearAnimTime = 5.f;
+    State.ActiveEnemyNum = State.TotalEnemyNum;
+    PlaceFormation();
+    Lanes->PrevGroupX[Lane] = Lanes->GroupX[Lane];
+    Lanes->PrevGroupY[Lane] = Lanes->GroupY[Lane];
+
+    const int InRow = Config.EnemiesInRow;
+    for (int Idx = 0; Idx < State.TotalEnemyNum; Idx++) {
+        EnemyAlive[Idx] = true;
+        PrevInColumn[Idx] = Idx >= InRow ? Idx - InRow : INDEX_NONE;
+        NextInColumn[Idx] =
+            Idx + InRow < State.TotalEnemyNum ? Idx + InRow : INDEX_NONE;
+    }
+
+    // First row shoots
+    ShootingColumns.Reset();
+    for (int Column = 0; Column < InRow; Column++) {
+        ColumnFront[Column] = Column;
+        ShootingColumnPos[Column] = ShootingColumns.Add(Column);
+    }
+}
+
+void FInvadersSim::SpawnPlayer() {
+    State.PlayerAppearAnimTime = 5.f;
+    PlayerVisible = true;
+    Lanes->PrevPlayerX[Lane] = Lanes->PlayerX[Lane];
+}
+
+void FInvadersSim::SpawnUfo() {
+    UfoVisible = true;
+    Lanes->PlaceUfo(Config, Lane);
+    Lanes->PrevUfoX[Lane] = Lanes->UfoX[Lane];
+}
+
+bool FInvadersSim::EmitEnemyBullet() {
+    if (ShootingColumns.Num() == 0) {
+        return false;
+    }
+    if (EnemyBullets.Num < EnemyBullets.Capacity) {
+        int Column =
+            ShootingColumns[Random.RandRange(0, ShootingColumns.Num() - 1)];
+        int Slot = ColumnFront[Column];
+        EnemyBullets.Add(
+            GetEnemyPos(Slot), Config.EnemyBulletVelocity,
+            MakeEntityId(EInvadersUnit::Enemy, EnemyTypes[Slot], Slot));
+    }
+    return true;
+}
+
+void FInvadersSim::EmitPlayerBullet() {
+    PlayerBullets.Add(GetPlayerPos(), -Config.PlayerBulletVelocity,
+                      MakeEntityId(EInvadersUnit::Player, 0, 0));
+}
+
+/// HIT RESOLUTION ///
+
+int FInvadersSim::FindFormationHit(const FVector2D& Pos) const {
+    // The formation is a regular grid, so the only candidate is the
+    // nearest cell
+    FVector2D Local = Pos - GetGroupPos();
+    int Column =
+        FMath::RoundToInt((Local[0] - FormationLeft) / FormationCell[0]);
+    int Row = FMath::RoundToInt(-Local[1] / FormationCell[1]);
+    if (Column < 0 || Column >= Config.EnemiesInRow || Row < 0 ||
+        Row >= Config.EnemiesInColumn) {
+        return INDEX_NONE;
+    }
+
+    int Slot = Row * Config.EnemiesInRow + Column;
+    if (!EnemyAlive[Slot]) {
+        return INDEX_NONE;
+    }
+    FVector2D Extent =
+        Config.EnemyTypeDefs[EnemyTypes[Slot]].Extent + Config.BulletExtent;
+    if (!InBounds(Local - EnemyOffsets[Slot], Extent)) {
+        return INDEX_NONE;
+    }
+    return Slot;
+}
+
+EInvadersUnit FInvadersSim::FindPlayerBulletTarget(const FVector2D& Pos,
+                                                   int& OutUnitIdx) const {
+    OutUnitIdx = INDEX_NONE;
+
+    FVector2D AsteroidExtent = Config.AsteroidExtent + Config.BulletExtent;
+    for (int Idx = 0; Idx < AsteroidPositions.Num(); Idx++) {
+        if (AsteroidHP[Idx] > 0 &&
+            InBounds(Pos - AsteroidPositions[Idx], AsteroidExtent)) {
+            OutUnitIdx = Idx;
+            return EInvadersUnit::Asteroid;
+        }
+    }
+
+    int Slot = FindFormationHit(Pos);
+    if (Slot != INDEX_NONE) {
+        OutUnitIdx = Slot;
+        return EInvadersUnit::Enemy;
+    }
+
+    FVector2D UfoExtent =
+        Config.EnemyTypeDefs.Last().Extent + Config.BulletExtent;
+    if (UfoVisible && InBounds(Pos - GetUfoPos(), UfoExtent)) {
+        return EInvadersUnit::Ufo;
+    }
+    return EInvadersUnit::None;
+}
+
+EInvadersUnit FInvadersSim::FindEnemyBulletTarget(const FVector2D& Pos,
+                                                  int& OutUnitIdx) const {
+    OutUnitIdx = INDEX_NONE;
+
+    FVector2D AsteroidExtent = Config.AsteroidExtent + Config.BulletExtent;
+    for (int Idx = 0; Idx < AsteroidPositions.Num(); Idx++) {
+        if (AsteroidHP[Idx] > 0 &&
+            InBounds(Pos - AsteroidPositions[Idx], AsteroidExtent)) {
+            OutUnitIdx = Idx;
+            return EInvadersUnit::Asteroid;
+        }
+    }
+
+    FVector2D PlayerExtent = Config.PlayerExtent + Config.BulletExtent;
+    if (PlayerVisible && InBounds(Pos - GetPlayerPos(), PlayerExtent)) {
+        return EInvadersUnit::Player;
+    }
+    return EInvadersUnit::None;
+}
+
+bool FInvadersSim::ResolvePlayerBulletHit(int BulletIdx,
+                                          EInvadersUnit Unit,
+                                          int UnitIdx) {
+    bool Hit = false;
+    switch (Unit) {
+        case EInvadersUnit::Enemy:
+            Hit = HitEnemy(UnitIdx);
+            break;
+        case EInvadersUnit::Ufo:
+            Hit = HitUfo();
+            break;
+        case EInvadersUnit::Asteroid:
+            Hit = HitAsteroid(UnitIdx);
+            break;
+        default:
+            break;
+    }
+    if (Hit) {
+        Events.Explosions.Add(PlayerBullets.GetPos(BulletIdx));
+        PlayerBullets.RemoveAtSwap(BulletIdx);
+    }
+    return Hit;
+}
+
+bool FInvadersSim::ResolveEnemyBulletHit(int BulletIdx,
+                                         EInvadersUnit Unit,
+                                         int UnitIdx) {
+    bool Hit = false;
+    switch (Unit) {
+        case EInvadersUnit::Asteroid:
+            Hit = HitAsteroid(UnitIdx);
+            break;
+        case EInvadersUnit::Player:
+            Hit = HitPlayer();
+            break;
+        default:
+            // Bullet to bullet contact
+            break;
+    }
+    if (Hit) {
+        Events.Explosions.Add(EnemyBullets.GetPos(BulletIdx));
+        EnemyBullets.RemoveAtSwap(BulletIdx);
+    }
+    return Hit;
+}
+
+bool FInvadersSim::HitEnemy(int Slot) {
+    if (!EnemyAlive[Slot]) {
+        return false;
+    }
+    EnemyAlive[Slot] = false;
+    State.Score += EnemyPoints[Slot];
+
+    // Update active enemy num and shooting enemies
+    State.ActiveEnemyNum--;
+    RemoveFromColumn(Slot);
+
+    // All enemies killed
+    if (State.ActiveEnemyNum == 0) {
+        State.CurrentLevel++;
+        Lanes->EnemyProgTime[Lane] = 0.f;
+        Events.WaveCleared = true;
+        SetTimer(EInvadersTimer::SpawnEnemies, 3.0);
+    }
+    return true;
+}
+
+void FInvadersSim::RemoveFromColumn(int Slot) {
+    int Column = Slot % Config.EnemiesInRow;
+    int Prev = PrevInColumn[Slot];
+    int Next = NextInColumn[Slot];
+
+    if (Prev != INDEX_NONE) {
+        NextInColumn[Prev] = Next;
+    } else {
+        // Front enemy died, the next alive one behind it starts shooting
+        ColumnFront[Column] = Next;
+    }
+    if (Next != INDEX_NONE) {
+        PrevInColumn[Next] = Prev;
+    }
+
+    // Column emptied, swap remove it from the shooting columns
+    if (ColumnFront[Column] == INDEX_NONE) {
+        int Pos = ShootingColumnPos[Column];
+        int LastColumn = ShootingColumns.Last();
+        ShootingColumns[Pos] = LastColumn;
+        ShootingColumnPos[LastColumn] = Pos;
+        ShootingColumns.Pop(false);
+        ShootingColumnPos[Column] = INDEX_NONE;
+    }
+}
+
+bool FInvadersSim::HitUfo() {
+    if (!UfoVisible) {
+        return false;
+    }
+    UfoVisible = false;
+    State.Score += UfoPoints;
+    Lanes->UfoProgTime[Lane] = 0.f;
+    Events.UfoDespawned = true;
+    SetTimer(EInvadersTimer::SpawnUfo, NextUfoDelay());
+    return true;
+}
+
+bool FInvadersSim::HitAsteroid(int Idx) {
+    if (AsteroidHP[Idx] <= 0) {
+        return false;
+    }
+    AsteroidHP[Idx]--;
+    return true;
+}
+
+bool FInvadersSim::HitPlayer() {
+    if (!PlayerVisible) {
+        return false;
+    }
+    State.CurrentLives--;
+    PlayerVisible = false;
+    PlayerShooting = false;
+    Timers.Clear(EInvadersTimer::PlayerShoot);
+    if (State.CurrentLives > 0) {
+        Lanes->PlayerX[Lane] = Config.PlayerSpawn[0];
+        SetTimer(EInvadersTimer::SpawnPlayer, 1.0);
+    }
+    Events.PlayerHit = true;
+    return true;
+}
+
+/// SNAPSHOTS ///
+
+// Ints as int32 one by one, so the archive sizes and byte swaps them
+static void SerializeInts(FArchive& Ar, TArray<int>& Values) {
+    for (int& Value : Values) {
+        int32 Element = Value;
+        Ar << Element;
+        Value = Element;
+    }
+}
+
+void FInvadersSim::SaveSnapshot(TArray<uint8>& OutData) const {
+    OutData.Reset();
+    FMemoryWriter Writer(OutData);
+
+    int32 Version = SnapshotVersion;
+    Writer << Version;
+    // Serializing doesn't change the state when saving
+    const_cast<FInvadersSim*>(this)->SerializeState(Writer);
+}
+
+bool FInvadersSim::LoadSnapshot(const TArray<uint8>& Data) {
+    FMemoryReader Reader(Data);
+
+    int32 Version = 0;
+    Reader << Version;
+    if (Version != SnapshotVersion) {
+        return false;
+    }
+    SerializeState(Reader);
+    if (Reader.IsError()) {
+        return false;
+    }
+    if (!RebuildColumns()) {
+        return false;
+    }
+    Events.Reset();
+    return true;
+}
+
+void FInvadersSim::SerializeState(FArchive& Ar) {
+    // Sizes come from the configuration, a mismatch is a snapshot of
+    // another setup
+    int32 EnemyNum = EnemyAlive.Num();
+    int32 AsteroidNum = AsteroidHP.Num();
+    Ar << EnemyNum << AsteroidNum;
+    if (EnemyNum != EnemyAlive.Num() || AsteroidNum != AsteroidHP.Num()) {
+        Ar.SetError();
+        return;
+    }
+
+    Ar << State.LevelStarted << State.EnemyAppearAnimTime
+       << State.PlayerAppearAnimTime << State.ActiveEnemyNum
+       << State.CurrentLevel << State.CurrentLives << State.Score
+       << State.PrevHiScore << State.HiScore;
+
+    int32 Seed = Random.GetCurrentSeed();
+    Ar << Seed;
+    if (Ar.IsLoading()) {
+        Random.Initialize(Seed);
+    }
+    Ar << Lanes->Clock[Lane] << Timers;
+
+    Ar << Lanes->PlayerX[Lane] << Lanes->PrevPlayerX[Lane]
+       << Lanes->PlayerMovement[Lane] << PlayerVisible << PlayerShooting;
+
+    Ar << Lanes->EnemyProgTime[Lane] << Lanes->GroupX[Lane]
+       << Lanes->GroupY[Lane] << Lanes->PrevGroupX[Lane]
+       << Lanes->PrevGroupY[Lane];
+    for (int Base = 0; Base < EnemyNum; Base += 8) {
+        uint8 Bits = 0;
+        const int BitNum = FMath::Min(8, EnemyNum - Base);
+        for (int Bit = 0; Bit < BitNum; Bit++) {
+            Bits |= uint8(EnemyAlive[Base + Bit]) << Bit;
+        }
+        Ar << Bits;
+        if (Ar.IsLoading()) {
+            for (int Bit = 0; Bit < BitNum; Bit++) {
+                EnemyAlive[Base + Bit] = (Bits >> Bit) & 1;
+            }
+        }
+    }
+    // Shooters are drawn by index, so their order is part of the state
+    int32 ShooterNum = ShootingColumns.Num();
+    Ar << ShooterNum;
+    if (ShooterNum < 0 || ShooterNum > Config.EnemiesInRow) {
+        Ar.SetError();
+        return;
+    }
+    ShootingColumns.SetNum(ShooterNum, false);
+    SerializeInts(Ar, ShootingColumns);
+    for (int Column : ShootingColumns) {
+        if (Column < 0 || Column >= Config.EnemiesInRow) {
+            Ar.SetError();
+            return;
+        }
+    }
+
+    Ar << Lanes->UfoProgTime[Lane] << Lanes->UfoX[Lane]
+       << Lanes->PrevUfoX[Lane] << UfoVisible;
+
+    SerializeInts(Ar, AsteroidHP);
+
+    Ar << PlayerBullets << EnemyBullets;
+}
+
+bool FInvadersSim::RebuildColumns() {
+    const int InRow = Config.EnemiesInRow;
+    int Alive = 0;
+    int Columns = 0;
+    for (int Column = 0; Column < InRow; Column++) {
+        ColumnFront[Column] = INDEX_NONE;
+        ShootingColumnPos[Column] = INDEX_NONE;
+
+        // Alive enemies linked front to back, like kills leave them
+        int Prev = INDEX_NONE;
+        for (int Slot = Column; Slot < State.TotalEnemyNum; Slot += InRow) {
+            if (!EnemyAlive[Slot]) {
+                continue;
+            }
+            PrevInColumn[Slot] = Prev;
+            NextInColumn[Slot] = INDEX_NONE;
+            if (Prev != INDEX_NONE) {
+                NextInColumn[Prev] = Slot;
+            } else {
+                ColumnFront[Column] = Slot;
+            }
+            Prev = Slot;
+            Alive++;
+        }
+        Columns += ColumnFront[Column] != INDEX_NONE;
+    }
+    // Every column with alive enemies has to be listed exactly once, the
+    // kills rely on it to unlist them
+    if (Alive != State.ActiveEnemyNum || Columns != ShootingColumns.Num()) {
+        return false;
+    }
+    for (int Pos = 0; Pos < ShootingColumns.Num(); Pos++) {
+        const int Column = ShootingColumns[Pos];
+        if (ColumnFront[Column] == INDEX_NONE ||
+            ShootingColumnPos[Column] != INDEX_NONE) {
+            return false;
+        }
+        ShootingColumnPos[Column] = Pos;
+    }
+    return true;
+}
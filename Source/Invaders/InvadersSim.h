@@ -0,0 +1,304 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InvadersBullets.h"
+#include "InvadersSimLanes.h"
+#include "InvadersStats.h"
+#include "InvadersTimers.h"
+#include "Math/RandomStream.h"
+#include "Templates/UniquePtr.h"
+
+// Lightweight game state;
+struct FInvadersGameState {
+    bool LevelStarted = false;
+    float EnemyAppearAnimTime = 0.f;
+    float PlayerAppearAnimTime = 0.f;
+    int TotalEnemyNum = 0;
+    int ActiveEnemyNum = 0;
+    int CurrentLevel = 0;
+    int CurrentLives = 0;
+
+    int32 Score = 0;
+    int32 PrevHiScore = 0;
+    int32 HiScore = 0;
+};
+
+struct FInvadersEnemyType {
+    int Points = 100;
+    // Half extents of the hit box on the xy-plane
+    FVector2D Extent = FVector2D(10, 10);
+};
+
+// Static simulation parameters. Filled from the game rules and unit
+// definitions by the game mode, or directly by headless callers.
+struct FInvadersSimConfig {
+    int EnemiesInRow = 10;
+    int EnemiesInColumn = 5;
+    float EnemySpread = 25.f;
+    float ForwardMovementAmount = 100.f;
+    float SideMovementAmount = 200.f;
+    float MinSpeedFactor = 0.25f;
+    int LastRow = 8;
+    float UfoAppearTimeMin = 6.f;
+    float UfoAppearTimeMax = 12.f;
+
+    // Seed of the gameplay random stream
+    int32 Seed = 0;
+
+    float PlayerSpeed = 250.f;
+    int PlayerLives = 3;
+
+    // Seconds between shots while the trigger is held
+    float PlayerShootInterval = 0.75f;
+    float EnemyShootInterval = 1.f;
+
+    float PlayerBulletVelocity = 100.f;
+    float EnemyBulletVelocity = 100.f;
+    float BulletRange = 500.f;
+    int MaxPlayerBullets = 20;
+    int MaxEnemyBullets = 20;
+
+    int AsteroidNum = 4;
+    int AsteroidHealth = 5;
+
+    // Last enemy type is reserved for the ufo
+    TArray<FInvadersEnemyType> EnemyTypeDefs = {{}, {}, {}};
+
+    // Resolve player bullet hits with grid and bounds math inside Step
+    // instead of waiting for engine overlaps
+    bool AnalyticPlayerHits = false;
+    // Same for enemy bullets against asteroids and the player
+    bool AnalyticEnemyHits = false;
+    // Splitting of the per bullet work over worker threads
+    FInvadersParallelConfig Parallel;
+    FVector2D AsteroidExtent = FVector2D(40, 40);
+    FVector2D BulletExtent = FVector2D(2, 2);
+    FVector2D PlayerExtent = FVector2D(20, 20);
+
+    FVector2D PlayerSpawn = FVector2D::ZeroVector;
+    FVector2D EnemySpawn = FVector2D::ZeroVector;
+    FVector2D UfoSpawn = FVector2D::ZeroVector;
+    FVector2D AsteroidSpawn = FVector2D::ZeroVector;
+};
+
+struct FInvadersInput {
+    float SideMovement = 0.f;
+    bool ShootPressed = false;
+    bool ShootReleased = false;
+};
+
+enum class EInvadersUnit : uint8 { None, Enemy, Ufo, Asteroid, Player };
+
+constexpr uint32 UnitMask(EInvadersUnit Unit) {
+    return 1u << uint32(Unit);
+}
+
+// Compact id carried by every unit actor. Unit kind in the high byte, type
+// index in the next one and slot in the low 16 bits. Zero is no unit.
+constexpr uint32 MakeEntityId(EInvadersUnit Unit, int Type, int Slot) {
+    return uint32(Unit) << 24 | uint32(Type & 0xff) << 16 |
+           uint32(Slot & 0xffff);
+}
+constexpr EInvadersUnit GetEntityUnit(uint32 Id) {
+    return EInvadersUnit(Id >> 24);
+}
+constexpr int GetEntityType(uint32 Id) {
+    return (Id >> 16) & 0xff;
+}
+constexpr int GetEntitySlot(uint32 Id) {
+    return Id & 0xffff;
+}
+
+// Things that happened during a step that the presentation layer reacts to.
+struct FInvadersSimEvents {
+    bool UfoDespawned = false;
+    bool WaveCleared = false;
+    bool PlayerHit = false;
+    TArray<FVector2D> Explosions;
+
+    void Reset() {
+        UfoDespawned = false;
+        WaveCleared = false;
+        PlayerHit = false;
+        Explosions.Reset();
+    }
+};
+
+// Engine independent gameplay simulation. Owns all gameplay state in flat
+// arrays, actors only mirror it for display. The state every step moves
+// lives in one lane of an FInvadersSimLanes, the simulation's own unless
+// a batch bound it to a lane of shared ones.
+class INVADERS_API FInvadersSim {
+   public:
+    static constexpr uint32 PlayerBulletTargets =
+        UnitMask(EInvadersUnit::Enemy) | UnitMask(EInvadersUnit::Ufo) |
+        UnitMask(EInvadersUnit::Asteroid);
+    static constexpr uint32 EnemyBulletTargets =
+        UnitMask(EInvadersUnit::Asteroid) | UnitMask(EInvadersUnit::Player);
+
+    FInvadersSimConfig Config;
+    FInvadersGameState State;
+    FInvadersSimEvents Events;
+
+    // Every gameplay random draw goes through this stream so a session
+    // replays exactly from its seed
+    FRandomStream Random;
+
+    // Per phase timings of Step, only gathered when set
+    FInvadersPhaseTimes* PhaseTimes = nullptr;
+
+    // Spawns and shooting, fired at the start of the step they fall due
+    FInvadersTimerQueue Timers;
+
+    FInvadersSimLanes* Lanes = nullptr;
+    int Lane = 0;
+
+    bool PlayerVisible;
+    bool PlayerShooting;
+
+    // Formation, enemy world position is the group position plus
+    // EnemyOffsets[Slot]
+    FVector2D FormationCell;
+    float FormationLeft;
+    TArray<FVector2D> EnemyOffsets;
+    TArray<int> EnemyTypes;
+    TArray<int> EnemyPoints;
+    TArray<bool> EnemyAlive;
+
+    // Shooters, the front alive enemy of each column. Alive enemies of a
+    // column are linked front to back so a kill unlinks in constant time.
+    TArray<int> ColumnFront;
+    TArray<int> NextInColumn;
+    TArray<int> PrevInColumn;
+    // Dense list of columns with alive enemies and each column's position
+    // in it
+    TArray<int> ShootingColumns;
+    TArray<int> ShootingColumnPos;
+
+    bool UfoVisible;
+    int UfoPoints;
+
+    TArray<FVector2D> AsteroidPositions;
+    TArray<int> AsteroidHP;
+
+    FInvadersBullets PlayerBullets;
+    FInvadersBullets EnemyBullets;
+
+    // Allocates the simulation's own lanes
+    void Init(const FInvadersSimConfig& InConfig);
+    // Binds to a lane of lanes initialised for the configuration's bullet
+    // capacities, owned by the caller
+    void Init(const FInvadersSimConfig& InConfig,
+              FInvadersSimLanes& InLanes,
+              int InLane);
+    void Restart();
+    void ResetUnits();
+
+    // Only for a simulation on its own lanes
+    void Step(float DeltaSeconds, const FInvadersInput& Input);
+
+    // Step in phases, for batches that run the kernels once over the lanes
+    // of all their games: BeginStep, the lanes' Advance, FireTimers, the
+    // lanes' Move kernels and bullet moves, then EndStep.
+    void BeginStep(const FInvadersInput& Input);
+    void FireTimers(float DeltaSeconds);
+    void EndStep();
+
+    double GetTime() const { return Lanes->Clock[Lane]; }
+
+    FVector2D GetPlayerPos() const {
+        return FVector2D(Lanes->PlayerX[Lane], Config.PlayerSpawn[1]);
+    }
+    FVector2D GetGroupPos() const {
+        return FVector2D(Lanes->GroupX[Lane], Lanes->GroupY[Lane]);
+    }
+    FVector2D GetUfoPos() const {
+        return FVector2D(Lanes->UfoX[Lane], Config.UfoSpawn[1]);
+    }
+    // Positions before the last step, for render interpolation. Spawns
+    // and resets snap them so units don't slide in from the old spot.
+    FVector2D GetPrevPlayerPos() const {
+        return FVector2D(Lanes->PrevPlayerX[Lane], Config.PlayerSpawn[1]);
+    }
+    FVector2D GetPrevGroupPos() const {
+        return FVector2D(Lanes->PrevGroupX[Lane], Lanes->PrevGroupY[Lane]);
+    }
+    FVector2D GetPrevUfoPos() const {
+        return FVector2D(Lanes->PrevUfoX[Lane], Config.UfoSpawn[1]);
+    }
+
+    // Whole gameplay state in a compact versioned blob, events and timing
+    // stats left out. The buffer keeps its allocation between saves.
+    void SaveSnapshot(TArray<uint8>& OutData) const;
+    // False if the snapshot is from another version or configuration, or
+    // is cut short. The state is only valid again after a Restart then.
+    bool LoadSnapshot(const TArray<uint8>& Data);
+
+    void SpawnEnemies();
+    void SpawnPlayer();
+    void SpawnUfo();
+
+    // Returns false when there are no enemies left to shoot
+    bool EmitEnemyBullet();
+    void EmitPlayerBullet();
+
+    float NextUfoDelay() {
+        return Random.FRandRange(Config.UfoAppearTimeMin,
+                                 Config.UfoAppearTimeMax);
+    }
+
+    // Apply a bullet hit on a unit. The bullet is consumed and true
+    // returned only if the unit was still alive.
+    bool ResolvePlayerBulletHit(int BulletIdx, EInvadersUnit Unit, int UnitIdx);
+    bool ResolveEnemyBulletHit(int BulletIdx, EInvadersUnit Unit, int UnitIdx);
+
+    FVector2D GetEnemyPos(int Slot) const {
+        return GetGroupPos() + EnemyOffsets[Slot];
+    }
+
+    // Formation slot under the position, INDEX_NONE if the cell is empty
+    int FindFormationHit(const FVector2D& Pos) const;
+    EInvadersUnit FindPlayerBulletTarget(const FVector2D& Pos,
+                                         int& OutUnitIdx) const;
+    EInvadersUnit FindEnemyBulletTarget(const FVector2D& Pos,
+                                        int& OutUnitIdx) const;
+
+   private:
+    TUniquePtr<FInvadersSimLanes> OwnLanes;
+
+    void StorePrevious();
+    void SetTimer(EInvadersTimer Timer, double Delay) {
+        Timers.Set(Timer, GetTime() + Delay);
+    }
+    void PlaceFormation();
+
+    void SerializeState(FArchive& Ar);
+    // Column links and positions from the alive flags and the shooting
+    // column order. False unless the shooting columns list each column
+    // with alive enemies once and the alive count matches the flags.
+    bool RebuildColumns();
+
+    void UpdateShooting(const FInvadersInput& Input);
+    void FireTimer(EInvadersTimer Timer);
+
+    void UpdateEnemyAppearAnimation(float DeltaSeconds);
+    void UpdatePlayerAppearAnimation(float DeltaSeconds);
+
+    // Inputs of the motion kernels
+    void StageMotion();
+    void UpdateUfoArrival();
+
+    void ResolvePlayerBulletHits();
+    // Analytic targets of the player bullets, found in parallel before
+    // the hits are applied in order
+    TArray<EInvadersUnit> PlayerBulletHitUnits;
+    TArray<int> PlayerBulletHitIdx;
+    void ResolveEnemyBulletHits();
+
+    bool HitEnemy(int Slot);
+    bool HitUfo();
+    bool HitAsteroid(int Idx);
+    bool HitPlayer();
+
+    void RemoveFromColumn(int Slot);
+};
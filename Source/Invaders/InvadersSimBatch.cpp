@@ -0,0 +1,142 @@
+#include "InvadersSimBatch.h"
+
+// Scalar fields at the front of each observation
+static constexpr int ObservationHeader = 11;
+
+void FInvadersSimBatch::Init(const FInvadersSimConfig& InConfig,
+                             int NumGames) {
+    check(NumGames > 0);
+
+    Config = InConfig;
+    // No actors to overlap with, and the batch is the one that fans out
+    Config.AnalyticPlayerHits = true;
+    Config.AnalyticEnemyHits = true;
+    Config.Parallel.MaxWorkers = 1;
+
+    Lanes.Init(NumGames, Config.MaxPlayerBullets, Config.MaxEnemyBullets);
+    Games.SetNum(NumGames);
+    FInvadersSimConfig GameConfig = Config;
+    for (int Game = 0; Game < NumGames; Game++) {
+        GameConfig.Seed = Config.Seed + Game;
+        Games[Game].Init(GameConfig, Lanes, Game);
+    }
+    GameSteps.Init(0, NumGames);
+    PrevScores.Init(0, NumGames);
+
+    ObservationSize = ObservationHeader +
+                      Config.EnemiesInRow * Config.EnemiesInColumn +
+                      Config.AsteroidNum +
+                      (Config.MaxPlayerBullets + Config.MaxEnemyBullets) * 2;
+    Observations.Init(0.f, NumGames * ObservationSize);
+    Rewards.Init(0.f, NumGames);
+    Dones.Init(0, NumGames);
+}
+
+void FInvadersSimBatch::Reset() {
+    InvadersParallelFor(Parallel, Games.Num(), [&](int Begin, int End) {
+        for (int Game = Begin; Game < End; Game++) {
+            Games[Game].Restart();
+            GameSteps[Game] = 0;
+            Rewards[Game] = 0.f;
+            Dones[Game] = 0;
+            WriteObservation(Game);
+        }
+    });
+}
+
+void FInvadersSimBatch::Step(float DeltaSeconds,
+                             TArrayView<const FInvadersInput> Inputs) {
+    check(Inputs.Num() == Games.Num());
+
+    FInvadersParallelConfig GroupParallel = Parallel;
+    GroupParallel.MinBatch = FMath::Max(Parallel.MinBatch / 4, 1);
+    const int Groups = Lanes.Num() / 4;
+
+    InvadersParallelFor(Parallel, Games.Num(), [&](int Begin, int End) {
+        for (int Game = Begin; Game < End; Game++) {
+            FInvadersSim& Sim = Games[Game];
+            if (Dones[Game]) {
+                Sim.Restart();
+                GameSteps[Game] = 0;
+            }
+            PrevScores[Game] = Sim.State.Score;
+            Sim.BeginStep(Inputs[Game]);
+        }
+    });
+    InvadersParallelFor(GroupParallel, Groups, [&](int Begin, int End) {
+        Lanes.Advance(DeltaSeconds, Begin * 4, End * 4);
+    });
+    InvadersParallelFor(Parallel, Games.Num(), [&](int Begin, int End) {
+        for (int Game = Begin; Game < End; Game++) {
+            Games[Game].FireTimers(DeltaSeconds);
+        }
+    });
+    InvadersParallelFor(GroupParallel, Groups, [&](int Begin, int End) {
+        MoveLanes(DeltaSeconds, Begin, End);
+    });
+    InvadersParallelFor(Parallel, Games.Num(), [&](int Begin, int End) {
+        for (int Game = Begin; Game < End; Game++) {
+            FInvadersSim& Sim = Games[Game];
+            Sim.EndStep();
+            GameSteps[Game]++;
+
+            Rewards[Game] = float(Sim.State.Score - PrevScores[Game]);
+            Dones[Game] =
+                Sim.State.CurrentLives == 0 ||
+                (MaxGameSteps > 0 && GameSteps[Game] >= MaxGameSteps);
+            WriteObservation(Game);
+        }
+    });
+}
+
+void FInvadersSimBatch::MoveLanes(float DeltaSeconds, int Begin, int End) {
+    Lanes.MovePlayers(Config, DeltaSeconds, Begin * 4, End * 4);
+    Lanes.MoveFormations(Config, DeltaSeconds, Begin * 4, End * 4);
+    Lanes.MoveUfos(Config, DeltaSeconds, Begin * 4, End * 4);
+
+    // Bullet stores of the same games, whole stores so dead lanes move too
+    const int FirstGame = Begin * 4;
+    const int LastGame = FMath::Min(End * 4, Games.Num());
+    for (FInvadersBulletLanes* Bullets :
+         {&Lanes.PlayerBullets, &Lanes.EnemyBullets}) {
+        const int StoreGroups = Bullets->Stride / 4;
+        Bullets->Move(DeltaSeconds, Config.BulletRange,
+                      FirstGame * StoreGroups, LastGame * StoreGroups);
+    }
+}
+
+void FInvadersSimBatch::WriteObservation(int Game) {
+    const FInvadersSim& Sim = Games[Game];
+    float* const Begin = Observations.GetData() + Game * ObservationSize;
+    float* Out = Begin;
+
+    *Out++ = Lanes.PlayerX[Game];
+    *Out++ = Sim.PlayerVisible;
+    *Out++ = Sim.State.CurrentLives;
+    *Out++ = Sim.State.CurrentLevel;
+    *Out++ = Lanes.GroupX[Game];
+    *Out++ = Lanes.GroupY[Game];
+    *Out++ = Sim.UfoVisible;
+    *Out++ = Lanes.UfoX[Game];
+    *Out++ = Sim.Config.UfoSpawn[1];
+    *Out++ = Sim.PlayerBullets.Num;
+    *Out++ = Sim.EnemyBullets.Num;
+
+    for (bool Alive : Sim.EnemyAlive) {
+        *Out++ = Alive;
+    }
+    for (int HP : Sim.AsteroidHP) {
+        *Out++ = HP;
+    }
+
+    // Live bullets first, the rest of the capacity zeroed
+    for (const FInvadersBullets* Bullets :
+         {&Sim.PlayerBullets, &Sim.EnemyBullets}) {
+        for (int Idx = 0; Idx < Bullets->Capacity; Idx++) {
+            bool Live = Idx < Bullets->Num;
+            *Out++ = Live ? Bullets->PosX[Idx] : 0.f;
+            *Out++ = Live ? Bullets->PosY[Idx] : 0.f;
+        }
+    }
+    check(Out == Begin + ObservationSize);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InvadersParallel.h"
+#include "InvadersSim.h"
+
+// Many independent headless games stepped in lockstep, for training and
+// balance sweeps without a world or game mode. The games share one
+// FInvadersSimLanes, so each step runs the motion kernels over all of them
+// four games per vector, with the per game work (timers, spawns, hits) in
+// between. Both are split into contiguous shards over the worker threads.
+// All buffers are sized by Init, stepping allocates nothing.
+//
+// A game that is done stays in its final state for the step that reports
+// it and restarts at the start of the next one, continuing its own random
+// stream. Game i is seeded with Config.Seed + i.
+class INVADERS_API FInvadersSimBatch {
+   public:
+    FInvadersSimBatch() = default;
+    // The games point into the batch's own lanes, a copy or move would
+    // leave them stepping the source's
+    FInvadersSimBatch(const FInvadersSimBatch&) = delete;
+    FInvadersSimBatch& operator=(const FInvadersSimBatch&) = delete;
+    FInvadersSimBatch(FInvadersSimBatch&&) = delete;
+    FInvadersSimBatch& operator=(FInvadersSimBatch&&) = delete;
+
+    // Games per task at least
+    FInvadersParallelConfig Parallel = {64};
+    // Steps before a game is cut short and reported done, zero for none
+    int MaxGameSteps = 0;
+
+    void Init(const FInvadersSimConfig& Config, int NumGames);
+    // Restarts every game and writes the first observations
+    void Reset();
+
+    // One step of every game, Inputs holds one input per game
+    void Step(float DeltaSeconds, TArrayView<const FInvadersInput> Inputs);
+
+    int Num() const { return Games.Num(); }
+    int GetObservationSize() const { return ObservationSize; }
+
+    // ObservationSize floats per game, see WriteObservation for the layout
+    TArrayView<const float> GetObservations() const { return Observations; }
+    TArrayView<const float> GetObservation(int Game) const {
+        return TArrayView<const float>(Observations)
+            .Slice(Game * ObservationSize, ObservationSize);
+    }
+    // Score gained in the last step
+    TArrayView<const float> GetRewards() const { return Rewards; }
+    // Nonzero when the last step ended the game
+    TArrayView<const uint8> GetDones() const { return Dones; }
+
+    const FInvadersSim& GetGame(int Game) const { return Games[Game]; }
+
+   private:
+    FInvadersSimConfig Config;
+    FInvadersSimLanes Lanes;
+    TArray<FInvadersSim> Games;
+    TArray<int> GameSteps;
+    // Score before the step, for the rewards
+    TArray<int32> PrevScores;
+
+    int ObservationSize = 0;
+    TArray<float> Observations;
+    TArray<float> Rewards;
+    TArray<uint8> Dones;
+
+    // Kernel pass over the lanes of the four game groups [Begin, End)
+    void MoveLanes(float DeltaSeconds, int Begin, int End);
+    void WriteObservation(int Game);
+};
@@ -0,0 +1,188 @@
+#include "InvadersSimLanes.h"
+
+#include "InvadersSim.h"
+#include "Math/VectorRegister.h"
+
+void FInvadersSimLanes::Init(int Games,
+                             int MaxPlayerBullets,
+                             int MaxEnemyBullets) {
+    const int Lanes = FMath::DivideAndRoundUp(Games, 4) * 4;
+    Clock.SetNumZeroed(Lanes);
+    for (TArray<float>* Array :
+         {&PlayerX, &PrevPlayerX, &PlayerMovement, &EnemyProgTime, &GroupX,
+          &GroupY, &PrevGroupX, &PrevGroupY, &UfoProgTime, &UfoX, &PrevUfoX,
+          &SideMovement, &PlayerMoves, &UfoMoves, &EnemySpeed,
+          &EnemyLevel}) {
+        Array->SetNumZeroed(Lanes);
+    }
+    PlayerBullets.Init(Games, MaxPlayerBullets);
+    EnemyBullets.Init(Games, MaxEnemyBullets);
+}
+
+/// KERNELS ///
+
+void FInvadersSimLanes::Advance(float DeltaSeconds, int Begin, int End) {
+    // Plain copies, left to the compiler
+    for (int Lane = Begin; Lane < End; Lane++) {
+        Clock[Lane] += DeltaSeconds;
+        PrevPlayerX[Lane] = PlayerX[Lane];
+        PrevGroupX[Lane] = GroupX[Lane];
+        PrevGroupY[Lane] = GroupY[Lane];
+        PrevUfoX[Lane] = UfoX[Lane];
+    }
+}
+
+void FInvadersSimLanes::MovePlayers(const FInvadersSimConfig& Config,
+                                    float DeltaSeconds,
+                                    int Begin,
+                                    int End) {
+    const VectorRegister4Float Zero = VectorSetFloat1(0.f);
+    const VectorRegister4Float Delta = VectorSetFloat1(DeltaSeconds);
+    const VectorRegister4Float Ease = VectorSetFloat1(DeltaSeconds * 5.f);
+    const VectorRegister4Float Speed = VectorSetFloat1(Config.PlayerSpeed);
+    const VectorRegister4Float Max =
+        VectorSetFloat1(Config.SideMovementAmount * 2);
+    const VectorRegister4Float Min =
+        VectorSetFloat1(-Config.SideMovementAmount * 2);
+
+    for (int Idx = Begin; Idx < End; Idx += 4) {
+        VectorRegister4Float Moves =
+            VectorCompareGT(VectorLoad(&PlayerMoves[Idx]), Zero);
+        VectorRegister4Float M = VectorLoad(&PlayerMovement[Idx]);
+        VectorRegister4Float X = VectorLoad(&PlayerX[Idx]);
+
+        // Eases towards the stick
+        VectorRegister4Float NewM = VectorAdd(
+            M, VectorMultiply(Ease,
+                              VectorSubtract(VectorLoad(&SideMovement[Idx]),
+                                             M)));
+        VectorRegister4Float NewX =
+            VectorAdd(X, VectorMultiply(VectorMultiply(NewM, Speed), Delta));
+        NewX = VectorMin(VectorMax(NewX, Min), Max);
+
+        VectorStore(VectorSelect(Moves, NewM, M), &PlayerMovement[Idx]);
+        VectorStore(VectorSelect(Moves, NewX, X), &PlayerX[Idx]);
+    }
+}
+
+void FInvadersSimLanes::MoveFormations(const FInvadersSimConfig& Config,
+                                       float DeltaSeconds,
+                                       int Begin,
+                                       int End) {
+    // Local side-to-side position is determined by the oscillation
+    // algorithm. Top values are clamped between [-1, 1] so that we have
+    // delays before resuming the side movement. Forward movement happens
+    // in-sync with the side-to-side movement, not oscillated but linearly
+    // interpolated. In addition we amplify and clamp the local forward
+    // position so that the forward movement occurs only when side movement
+    // has paused.
+
+    // TODO: Forward movement doesn't quite work yet with different
+    //       OscXYRatio values
+    //       Figure out why if theres time
+    const VectorRegister4Float OscXYRatio = VectorSetFloat1(2.f);
+
+    const VectorRegister4Float Zero = VectorSetFloat1(0.f);
+    const VectorRegister4Float Half = VectorSetFloat1(0.5f);
+    const VectorRegister4Float Quarter = VectorSetFloat1(0.25f);
+    const VectorRegister4Float One = VectorSetFloat1(1.f);
+    const VectorRegister4Float MinusOne = VectorSetFloat1(-1.f);
+    const VectorRegister4Float Two = VectorSetFloat1(2.f);
+    const VectorRegister4Float Four = VectorSetFloat1(4.f);
+    const VectorRegister4Float Delta = VectorSetFloat1(DeltaSeconds);
+    const VectorRegister4Float LastRow = VectorSetFloat1(float(Config.LastRow));
+    const VectorRegister4Float SpawnX =
+        VectorSetFloat1(float(Config.EnemySpawn[0]));
+    const VectorRegister4Float SpawnY =
+        VectorSetFloat1(float(Config.EnemySpawn[1]));
+    const VectorRegister4Float Side =
+        VectorSetFloat1(Config.SideMovementAmount);
+    const VectorRegister4Float Forward =
+        VectorSetFloat1(Config.ForwardMovementAmount);
+
+    for (int Idx = Begin; Idx < End; Idx += 4) {
+        VectorRegister4Float Time = VectorAdd(
+            VectorLoad(&EnemyProgTime[Idx]),
+            VectorMultiply(Delta, VectorLoad(&EnemySpeed[Idx])));
+        VectorStore(Time, &EnemyProgTime[Idx]);
+
+        // Oscillate between [-1, 1]
+        VectorRegister4Float N = VectorSubtract(
+            Time, VectorMultiply(Four, VectorTruncate(
+                                           VectorMultiply(Time, Quarter))));
+        VectorRegister4Float SideDirection =
+            VectorSubtract(One, VectorAbs(VectorSubtract(N, Two)));
+        // Offset x local position
+        VectorRegister4Float RowPosition =
+            VectorMin(VectorMultiply(VectorAdd(Time, Half), Half), LastRow);
+        VectorRegister4Float RowInt = VectorTruncate(RowPosition);
+        VectorRegister4Float RowFract = VectorSubtract(RowPosition, RowInt);
+        RowInt = VectorAdd(VectorLoad(&EnemyLevel[Idx]), RowInt);
+
+        VectorRegister4Float SideN = VectorMin(
+            VectorMax(VectorMultiply(SideDirection, OscXYRatio), MinusOne),
+            One);
+        VectorRegister4Float ForwardN = VectorMin(
+            VectorMax(VectorMultiply(RowFract, OscXYRatio), Zero), One);
+        VectorStore(VectorAdd(SpawnX, VectorMultiply(Side, SideN)),
+                    &GroupX[Idx]);
+        VectorStore(VectorAdd(VectorAdd(SpawnY, VectorMultiply(RowInt,
+                                                               Forward)),
+                              VectorMultiply(Forward, ForwardN)),
+                    &GroupY[Idx]);
+    }
+}
+
+void FInvadersSimLanes::MoveUfos(const FInvadersSimConfig& Config,
+                                 float DeltaSeconds,
+                                 int Begin,
+                                 int End) {
+    const VectorRegister4Float Zero = VectorSetFloat1(0.f);
+    const VectorRegister4Float Delta = VectorSetFloat1(DeltaSeconds);
+    const VectorRegister4Float Crossing = VectorSetFloat1(1.f / 5.f);
+    const float FromX = Config.UfoSpawn[0];
+    const VectorRegister4Float From = VectorSetFloat1(FromX);
+    const VectorRegister4Float Span = VectorSetFloat1(-FromX * 2);
+
+    // Arrivals are handled by each game after the pass
+    for (int Idx = Begin; Idx < End; Idx += 4) {
+        VectorRegister4Float Moves =
+            VectorCompareGT(VectorLoad(&UfoMoves[Idx]), Zero);
+        VectorRegister4Float Time = VectorLoad(&UfoProgTime[Idx]);
+        VectorRegister4Float X = VectorLoad(&UfoX[Idx]);
+
+        VectorRegister4Float NewTime = VectorAdd(Time, Delta);
+        VectorRegister4Float NewX = VectorAdd(
+            From, VectorMultiply(VectorMultiply(NewTime, Crossing), Span));
+
+        VectorStore(VectorSelect(Moves, NewTime, Time), &UfoProgTime[Idx]);
+        VectorStore(VectorSelect(Moves, NewX, X), &UfoX[Idx]);
+    }
+}
+
+/// PLACEMENT ///
+
+void FInvadersSimLanes::PlaceFormation(const FInvadersSimConfig& Config,
+                                       int Lane) {
+    const float Time = EnemyProgTime[Lane];
+    float N = Time - 4.f * FMath::TruncToFloat(Time * 0.25f);
+    float SideDirection = 1.f - FMath::Abs(N - 2.f);
+    float RowPosition =
+        FMath::Min((Time + 0.5f) * 0.5f, float(Config.LastRow));
+    float RowInt = FMath::TruncToFloat(RowPosition);
+    float RowFract = RowPosition - RowInt;
+    RowInt = EnemyLevel[Lane] + RowInt;
+
+    const float Side = Config.SideMovementAmount;
+    const float Forward = Config.ForwardMovementAmount;
+    GroupX[Lane] = float(Config.EnemySpawn[0]) +
+                   Side * FMath::Clamp(SideDirection * 2.f, -1.f, 1.f);
+    GroupY[Lane] = float(Config.EnemySpawn[1]) + RowInt * Forward +
+                   Forward * FMath::Clamp(RowFract * 2.f, 0.f, 1.f);
+}
+
+void FInvadersSimLanes::PlaceUfo(const FInvadersSimConfig& Config,
+                                 int Lane) {
+    const float From = Config.UfoSpawn[0];
+    UfoX[Lane] = From + UfoProgTime[Lane] * (1.f / 5.f) * (-From * 2);
+}
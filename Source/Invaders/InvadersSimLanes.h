@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InvadersBullets.h"
+
+struct FInvadersSimConfig;
+
+// Per game state that every step moves, as structure of arrays. Lane L of
+// each array belongs to game L. A lone simulation owns lanes for its one
+// game and a batch owns them for all of its games, and the kernels move
+// four lanes per vector either way, so a batched game steps exactly like
+// a lone one. Lanes are padded to whole vectors, padding lanes are moved
+// like the others and never read.
+struct INVADERS_API FInvadersSimLanes {
+    // Simulation time, the timer queues count in it
+    TArray<double> Clock;
+
+    // The player only moves sideways and the ufo only crosses the field,
+    // their other coordinate is the spawn point's
+    TArray<float> PlayerX;
+    TArray<float> PrevPlayerX;
+    TArray<float> PlayerMovement;
+
+    // The formation is placed from its progress
+    TArray<float> EnemyProgTime;
+    TArray<float> GroupX;
+    TArray<float> GroupY;
+    TArray<float> PrevGroupX;
+    TArray<float> PrevGroupY;
+
+    TArray<float> UfoProgTime;
+    TArray<float> UfoX;
+    TArray<float> PrevUfoX;
+
+    // Staged by each game before the motion kernels. Units move in lanes
+    // where their flag is nonzero.
+    TArray<float> SideMovement;
+    TArray<float> PlayerMoves;
+    TArray<float> UfoMoves;
+    TArray<float> EnemySpeed;
+    TArray<float> EnemyLevel;
+
+    // Bullet store G belongs to game G
+    FInvadersBulletLanes PlayerBullets;
+    FInvadersBulletLanes EnemyBullets;
+
+    void Init(int Games, int MaxPlayerBullets, int MaxEnemyBullets);
+
+    // Lanes including the padding, a multiple of four
+    int Num() const { return Clock.Num(); }
+
+    // Kernels over the lanes [Begin, End), both multiples of four. All the
+    // games in the range share the configuration.
+
+    // Keeps the positions for render interpolation and moves the clocks
+    void Advance(float DeltaSeconds, int Begin, int End);
+    void MovePlayers(const FInvadersSimConfig& Config,
+                     float DeltaSeconds,
+                     int Begin,
+                     int End);
+    void MoveFormations(const FInvadersSimConfig& Config,
+                        float DeltaSeconds,
+                        int Begin,
+                        int End);
+    void MoveUfos(const FInvadersSimConfig& Config,
+                  float DeltaSeconds,
+                  int Begin,
+                  int End);
+
+    // Scalar placement of one lane from its progress, the same arithmetic
+    // as the kernels. For spawns and resets between steps.
+    void PlaceFormation(const FInvadersSimConfig& Config, int Lane);
+    void PlaceUfo(const FInvadersSimConfig& Config, int Lane);
+};
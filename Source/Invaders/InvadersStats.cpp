@@ -0,0 +1,21 @@
+#include "InvadersStats.h"
+
+DEFINE_STAT(STAT_InvadersEnemyAppear);
+DEFINE_STAT(STAT_InvadersPlayerAppear);
+DEFINE_STAT(STAT_InvadersPlayerMovement);
+DEFINE_STAT(STAT_InvadersEnemyMovement);
+DEFINE_STAT(STAT_InvadersUfoMovement);
+DEFINE_STAT(STAT_InvadersPlayerBullets);
+DEFINE_STAT(STAT_InvadersEnemyBullets);
+DEFINE_STAT(STAT_InvadersHits);
+DEFINE_STAT(STAT_InvadersSync);
+DEFINE_STAT(STAT_InvadersOverlaps);
+DEFINE_STAT(STAT_InvadersEvents);
+
+DEFINE_STAT(STAT_InvadersPlayerBulletNum);
+DEFINE_STAT(STAT_InvadersEnemyBulletNum);
+DEFINE_STAT(STAT_InvadersAliveEnemyNum);
+DEFINE_STAT(STAT_InvadersOverlapQueries);
+DEFINE_STAT(STAT_InvadersActorsSynced);
+DEFINE_STAT(STAT_InvadersSoundsPlayed);
+DEFINE_STAT(STAT_InvadersSoundsThrottled);
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+
+// `stat Invaders` in game, the phases also show up in Insights cpu traces
+DECLARE_STATS_GROUP(TEXT("Invaders"), STATGROUP_Invaders, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy appear"),
+                          STAT_InvadersEnemyAppear,
+                          STATGROUP_Invaders,
+                          INVADERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Player appear"),
+                          STAT_InvadersPlayerAppear,
+                          STATGROUP_Invaders,
+                          INVADERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Player movement"),
+                          STAT_InvadersPlayerMovement,
+                          STATGROUP_Invaders,
+                          INVADERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy movement"),
+                          STAT_InvadersEnemyMovement,
+                          STATGROUP_Invaders,
+                          INVADERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Ufo movement"),
+                          STAT_InvadersUfoMovement,
+                          STATGROUP_Invaders,
+                          INVADERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Player bullets"),
+                          STAT_InvadersPlayerBullets,
+                          STATGROUP_Invaders,
+                          INVADERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy bullets"),
+                          STAT_InvadersEnemyBullets,
+                          STATGROUP_Invaders,
+                          INVADERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Hits"),
+                          STAT_InvadersHits,
+                          STATGROUP_Invaders,
+                          INVADERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Sync actors"),
+                          STAT_InvadersSync,
+                          STATGROUP_Invaders,
+                          INVADERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Overlaps"),
+                          STAT_InvadersOverlaps,
+                          STATGROUP_Invaders,
+                          INVADERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Events"),
+                          STAT_InvadersEvents,
+                          STATGROUP_Invaders,
+                          INVADERS_API);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Player bullets"),
+                                      STAT_InvadersPlayerBulletNum,
+                                      STATGROUP_Invaders,
+                                      INVADERS_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Enemy bullets"),
+                                      STAT_InvadersEnemyBulletNum,
+                                      STATGROUP_Invaders,
+                                      INVADERS_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Alive enemies"),
+                                      STAT_InvadersAliveEnemyNum,
+                                      STATGROUP_Invaders,
+                                      INVADERS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Overlap queries"),
+                                  STAT_InvadersOverlapQueries,
+                                  STATGROUP_Invaders,
+                                  INVADERS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Actors synced"),
+                                  STAT_InvadersActorsSynced,
+                                  STATGROUP_Invaders,
+                                  INVADERS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sounds played"),
+                                  STAT_InvadersSoundsPlayed,
+                                  STATGROUP_Invaders,
+                                  INVADERS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sounds throttled"),
+                                  STAT_InvadersSoundsThrottled,
+                                  STATGROUP_Invaders,
+                                  INVADERS_API);
+
+// Gameplay loop phases, also measured by the benchmark
+enum class EInvadersPhase : uint8 {
+    EnemyAppear,
+    PlayerAppear,
+    PlayerMovement,
+    EnemyMovement,
+    UfoMovement,
+    PlayerBullets,
+    EnemyBullets,
+    Hits,
+    Sync,
+    Overlaps,
+    Events,
+    Num
+};
+
+inline const TCHAR* GetPhaseName(EInvadersPhase Phase) {
+    static const TCHAR* Names[] = {
+        TEXT("EnemyAppear"),   TEXT("PlayerAppear"),  TEXT("PlayerMovement"),
+        TEXT("EnemyMovement"), TEXT("UfoMovement"),   TEXT("PlayerBullets"),
+        TEXT("EnemyBullets"),  TEXT("Hits"),          TEXT("Sync"),
+        TEXT("Overlaps"),      TEXT("Events"),
+    };
+    static_assert(UE_ARRAY_COUNT(Names) == int(EInvadersPhase::Num));
+    return Names[int(Phase)];
+}
+
+struct FInvadersPhaseTimes {
+    uint64 Cycles[int(EInvadersPhase::Num)] = {};
+};
+
+// Adds the scope duration to the phase, free when no times are attached
+struct FInvadersPhaseScope {
+    FInvadersPhaseScope(FInvadersPhaseTimes* InTimes, EInvadersPhase InPhase)
+        : Times(InTimes),
+          Phase(InPhase),
+          Start(InTimes ? FPlatformTime::Cycles64() : 0) {}
+
+    ~FInvadersPhaseScope() {
+        if (Times) {
+            Times->Cycles[int(Phase)] += FPlatformTime::Cycles64() - Start;
+        }
+    }
+
+    FInvadersPhaseTimes* Times;
+    EInvadersPhase Phase;
+    uint64 Start;
+};
+
+// Cycle stat, Insights trace event and benchmark timing of a phase
+#define INVADERS_PHASE_SCOPE(Times, Phase)                             \
+    TRACE_CPUPROFILER_EVENT_SCOPE(Invaders_##Phase);                   \
+    SCOPE_CYCLE_COUNTER(STAT_Invaders##Phase);                         \
+    FInvadersPhaseScope InvadersPhaseScope(Times, EInvadersPhase::Phase)
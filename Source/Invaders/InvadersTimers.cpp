@@ -0,0 +1,74 @@
+#include "InvadersTimers.h"
+
+void FInvadersTimerQueue::Reset() {
+    Heap.Reset();
+    NextOrder = 0;
+}
+
+void FInvadersTimerQueue::Set(EInvadersTimer Timer, double Time) {
+    Clear(Timer);
+    Heap.HeapPush({Time, NextOrder++, Timer});
+}
+
+void FInvadersTimerQueue::Clear(EInvadersTimer Timer) {
+    int Idx = Find(Timer);
+    if (Idx != INDEX_NONE) {
+        Heap.HeapRemoveAt(Idx, false);
+    }
+}
+
+bool FInvadersTimerQueue::IsActive(EInvadersTimer Timer) const {
+    return Find(Timer) != INDEX_NONE;
+}
+
+bool FInvadersTimerQueue::PopDue(double Now, EInvadersTimer& OutTimer) {
+    if (Heap.Num() == 0 || Heap.HeapTop().Time > Now) {
+        return false;
+    }
+    FEntry Entry;
+    Heap.HeapPop(Entry, false);
+    OutTimer = Entry.Timer;
+    return true;
+}
+
+int FInvadersTimerQueue::Find(EInvadersTimer Timer) const {
+    // One entry per timer type, a scan beats an index to keep in sync
+    for (int Idx = 0; Idx < Heap.Num(); Idx++) {
+        if (Heap[Idx].Timer == Timer) {
+            return Idx;
+        }
+    }
+    return INDEX_NONE;
+}
+
+FArchive& operator<<(FArchive& Ar, FInvadersTimerQueue& Queue) {
+    Ar << Queue.NextOrder;
+
+    int32 Num = Queue.Heap.Num();
+    Ar << Num;
+    if (Num < 0 || Num > int(EInvadersTimer::Num)) {
+        Ar.SetError();
+        return Ar;
+    }
+    if (Ar.IsLoading()) {
+        Queue.Heap.SetNum(Num);
+    }
+    // One entry per type, Set and Clear only ever find the first
+    uint32 Seen = 0;
+    for (FInvadersTimerQueue::FEntry& Entry : Queue.Heap) {
+        uint8 Timer = uint8(Entry.Timer);
+        Ar << Entry.Time << Entry.Order << Timer;
+        if (Timer >= uint8(EInvadersTimer::Num) || (Seen & (1u << Timer))) {
+            Ar.SetError();
+            return Ar;
+        }
+        Seen |= 1u << Timer;
+        Entry.Timer = EInvadersTimer(Timer);
+    }
+    // Saved in heap order, which this leaves as is. Anything else is put
+    // back in order rather than trusted.
+    if (Ar.IsLoading()) {
+        Queue.Heap.Heapify();
+    }
+    return Ar;
+}
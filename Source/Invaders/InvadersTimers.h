@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Gameplay timers, at most one of each type is pending
+enum class EInvadersTimer : uint8 {
+    SpawnPlayer,
+    SpawnEnemies,
+    SpawnUfo,
+    EnemyShoot,
+    PlayerShoot,
+    Num
+};
+
+// Min-heap of pending timers in simulation time. The clock is the
+// simulation's and only moves with its steps, so timers pause with the
+// simulation and fire the same way however the steps are spread over
+// frames. Timers due at the same time fire in the order they were set.
+class INVADERS_API FInvadersTimerQueue {
+   public:
+    FInvadersTimerQueue() { Heap.Reserve(int(EInvadersTimer::Num)); }
+
+    // Drops all timers
+    void Reset();
+
+    // Fires the timer at Time, replacing the pending one
+    void Set(EInvadersTimer Timer, double Time);
+    void Clear(EInvadersTimer Timer);
+    bool IsActive(EInvadersTimer Timer) const;
+
+    // Pops the earliest timer due by Now, false when there is none
+    bool PopDue(double Now, EInvadersTimer& OutTimer);
+
+    friend FArchive& operator<<(FArchive& Ar, FInvadersTimerQueue& Queue);
+
+   private:
+    struct FEntry {
+        double Time;
+        uint32 Order;
+        EInvadersTimer Timer;
+
+        bool operator<(const FEntry& Other) const {
+            return Time < Other.Time ||
+                   (Time == Other.Time && Order < Other.Order);
+        }
+    };
+
+    TArray<FEntry> Heap;
+    uint32 NextOrder = 0;
+
+    int Find(EInvadersTimer Timer) const;
+};
@@ -0,0 +1,728 @@
+#include "HAL/FileManager.h"
+#include "InvadersAllocCounter.h"
+#include "InvadersInputSource.h"
+#include "InvadersReplay.h"
+#include "InvadersSim.h"
+#include "InvadersSimBatch.h"
+#include "InvadersTimers.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+static constexpr float TestStepTime = 1.f / 120.f;
+
+// Bullets reach the formation and the player, so kills, deaths and
+// restarts happen within the steps
+static FInvadersSimConfig MakeHitConfig() {
+    FInvadersSimConfig Config;
+    Config.AnalyticPlayerHits = true;
+    Config.AnalyticEnemyHits = true;
+    Config.Parallel.MaxWorkers = 1;
+    Config.EnemySpawn = FVector2D(0, -900);
+    Config.UfoSpawn = FVector2D(600, -1000);
+    Config.BulletRange = 1200.f;
+    Config.PlayerBulletVelocity = 600.f;
+    Config.EnemyBulletVelocity = 300.f;
+    return Config;
+}
+
+static FInvadersInput MakeSimInput(const FInvadersInputFrame& Frame) {
+    FInvadersInput Input;
+    Input.SideMovement = Frame.GetSideMovement();
+    Input.ShootPressed = Frame.ShootPressed;
+    Input.ShootReleased = Frame.ShootReleased;
+    return Input;
+}
+
+// Steps with sweeping input, restarting once the lives run out
+static void StepSweep(FInvadersSim& Sim,
+                      FInvadersSweepInput& Source,
+                      int Steps) {
+    for (int Step = 0; Step < Steps; Step++) {
+        Sim.Step(TestStepTime, MakeSimInput(Source.MakeInput(Sim)));
+        if (Sim.State.CurrentLives == 0) {
+            Sim.Restart();
+        }
+    }
+}
+
+/// ALLOCATIONS ///
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInvadersSimStepAllocTest,
+                                 "Invaders.Sim.StepDoesNotAllocate",
+                                 EAutomationTestFlags::ApplicationContextMask |
+                                     EAutomationTestFlags::EngineFilter)
+
+bool FInvadersSimStepAllocTest::RunTest(const FString& Parameters) {
+    FInvadersSim Sim;
+    Sim.Init(MakeHitConfig());
+    Sim.Restart();
+    FInvadersSweepInput Source;
+
+    const int WarmupSteps = 240;
+    const int Steps = 120 * 60;
+    FInvadersAllocCounter& Counter = FInvadersAllocCounter::Get();
+    const bool Installed = Counter.IsInstalled();
+    if (!Installed) {
+        Counter.Install();
+    }
+
+    StepSweep(Sim, Source, WarmupSteps);
+    const uint64 StartCalls = Counter.GetCalls();
+    {
+        FInvadersAllocCountScope CountScope;
+        StepSweep(Sim, Source, Steps);
+    }
+    const uint64 Allocations = Counter.GetCalls() - StartCalls;
+
+    if (!Installed) {
+        Counter.Uninstall();
+    }
+    TestEqual(TEXT("Allocations after warmup"), Allocations, uint64(0));
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInvadersSimParallelStepAllocTest,
+                                 "Invaders.Sim.ParallelStepDoesNotAllocate",
+                                 EAutomationTestFlags::ApplicationContextMask |
+                                     EAutomationTestFlags::EngineFilter)
+
+bool FInvadersSimParallelStepAllocTest::RunTest(const FString& Parameters) {
+    // The player shoots every step into pools larger than MinBatch, and
+    // the slow bullets pile up past it, so the bullet loops fan out
+    FInvadersSimConfig Config = MakeHitConfig();
+    Config.Parallel.MaxWorkers = 0;
+    Config.MaxPlayerBullets = 1024;
+    Config.MaxEnemyBullets = 1024;
+    Config.PlayerShootInterval = TestStepTime;
+    Config.PlayerBulletVelocity = 100.f;
+    Config.PlayerLives = MAX_int32;
+
+    FInvadersSim Sim;
+    Sim.Init(Config);
+    Sim.Restart();
+    FInvadersSweepInput Source;
+
+    const int WarmupSteps = 240;
+    const int Steps = 120 * 20;
+    FInvadersAllocCounter& Counter = FInvadersAllocCounter::Get();
+    const bool Installed = Counter.IsInstalled();
+    if (!Installed) {
+        Counter.Install();
+    }
+
+    StepSweep(Sim, Source, WarmupSteps);
+    const uint64 StartCalls = Counter.GetCalls();
+    int MaxBullets = 0;
+    {
+        FInvadersAllocCountScope CountScope;
+        for (int Step = 0; Step < Steps; Step++) {
+            StepSweep(Sim, Source, 1);
+            MaxBullets = FMath::Max(MaxBullets, Sim.PlayerBullets.Num);
+        }
+    }
+    const uint64 Allocations = Counter.GetCalls() - StartCalls;
+
+    if (!Installed) {
+        Counter.Uninstall();
+    }
+    TestTrue(TEXT("Bullets past MinBatch"),
+             MaxBullets > Config.Parallel.MinBatch);
+    TestEqual(TEXT("Allocations after warmup"), Allocations, uint64(0));
+    return true;
+}
+
+/// SNAPSHOTS ///
+
+// Spawns are done and the formation has taken hits by then
+static constexpr int MidGameSteps = 120 * 6;
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInvadersSimSnapshotRoundTripTest,
+                                 "Invaders.Sim.Snapshot.RoundTrip",
+                                 EAutomationTestFlags::ApplicationContextMask |
+                                     EAutomationTestFlags::EngineFilter)
+
+bool FInvadersSimSnapshotRoundTripTest::RunTest(const FString& Parameters) {
+    const FInvadersSimConfig Config = MakeHitConfig();
+    FInvadersSim Sim;
+    Sim.Init(Config);
+    Sim.Restart();
+    FInvadersSweepInput Source;
+    StepSweep(Sim, Source, MidGameSteps);
+    TestTrue(TEXT("Formation alive mid-game"), Sim.State.ActiveEnemyNum > 0);
+
+    TArray<uint8> Saved;
+    Sim.SaveSnapshot(Saved);
+    FInvadersSim Loaded;
+    Loaded.Init(Config);
+    if (!TestTrue(TEXT("Snapshot loads"), Loaded.LoadSnapshot(Saved))) {
+        return false;
+    }
+    TArray<uint8> Resaved;
+    Loaded.SaveSnapshot(Resaved);
+    TestTrue(TEXT("Save of the loaded state matches"), Resaved == Saved);
+
+    // Both games get the same input, drawn from the original
+    for (int Step = 0; Step < 120 * 30; Step++) {
+        FInvadersInput Input = MakeSimInput(Source.MakeInput(Sim));
+        for (FInvadersSim* Game : {&Sim, &Loaded}) {
+            Game->Step(TestStepTime, Input);
+            if (Game->State.CurrentLives == 0) {
+                Game->Restart();
+            }
+        }
+        Sim.SaveSnapshot(Saved);
+        Loaded.SaveSnapshot(Resaved);
+        if (Resaved != Saved) {
+            AddError(FString::Printf(
+                TEXT("Loaded game left the original at step %d"), Step));
+            return false;
+        }
+    }
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInvadersSimSnapshotRejectTest,
+                                 "Invaders.Sim.Snapshot.RejectsInvalid",
+                                 EAutomationTestFlags::ApplicationContextMask |
+                                     EAutomationTestFlags::EngineFilter)
+
+bool FInvadersSimSnapshotRejectTest::RunTest(const FString& Parameters) {
+    const FInvadersSimConfig Config = MakeHitConfig();
+    FInvadersSim Sim;
+    Sim.Init(Config);
+    Sim.Restart();
+    FInvadersSweepInput Source;
+    StepSweep(Sim, Source, MidGameSteps);
+    if (!TestTrue(TEXT("Two columns shooting mid-game"),
+                  Sim.ShootingColumns.Num() >= 2)) {
+        return false;
+    }
+
+    TArray<uint8> Valid;
+    Sim.SaveSnapshot(Valid);
+    FInvadersSim Loader;
+    Loader.Init(Config);
+    TestTrue(TEXT("Valid snapshot loads"), Loader.LoadSnapshot(Valid));
+
+    TArray<uint8> Data = Valid;
+    int32 Version = 0;
+    FMemory::Memcpy(&Version, Data.GetData(), sizeof(Version));
+    Version++;
+    FMemory::Memcpy(Data.GetData(), &Version, sizeof(Version));
+    TestFalse(TEXT("Other version"), Loader.LoadSnapshot(Data));
+
+    Data = Valid;
+    Data.SetNum(Data.Num() - 1);
+    TestFalse(TEXT("Last byte cut off"), Loader.LoadSnapshot(Data));
+    Data = Valid;
+    Data.SetNum(Data.Num() / 2);
+    TestFalse(TEXT("Cut in half"), Loader.LoadSnapshot(Data));
+
+    FInvadersSimConfig OtherConfig = Config;
+    OtherConfig.EnemiesInColumn--;
+    FInvadersSim Other;
+    Other.Init(OtherConfig);
+    TestFalse(TEXT("Other formation size"), Other.LoadSnapshot(Valid));
+    OtherConfig = Config;
+    OtherConfig.AsteroidNum++;
+    Other.Init(OtherConfig);
+    TestFalse(TEXT("Other asteroid count"), Other.LoadSnapshot(Valid));
+
+    // Saving doesn't check the state, so a broken one saves as is
+    auto LoadTampered = [&](TFunctionRef<void(FInvadersSim&)> Tamper) {
+        FInvadersSim Tampered;
+        Tampered.Init(Config);
+        Tampered.LoadSnapshot(Valid);
+        Tamper(Tampered);
+        Tampered.SaveSnapshot(Data);
+        return Loader.LoadSnapshot(Data);
+    };
+    TestFalse(TEXT("Shooting column missing"),
+              LoadTampered([](FInvadersSim& S) { S.ShootingColumns.Pop(); }));
+    TestFalse(TEXT("Shooting column listed twice"),
+              LoadTampered([](FInvadersSim& S) {
+                  S.ShootingColumns.Last() = S.ShootingColumns[0];
+              }));
+    TestFalse(TEXT("Shooting column out of range"),
+              LoadTampered([](FInvadersSim& S) {
+                  S.ShootingColumns[0] = S.Config.EnemiesInRow;
+              }));
+    TestFalse(TEXT("Shooting column without alive enemies"),
+              LoadTampered([](FInvadersSim& S) {
+                  const int InRow = S.Config.EnemiesInRow;
+                  for (int Slot = S.ShootingColumns[0];
+                       Slot < S.State.TotalEnemyNum; Slot += InRow) {
+                      if (S.EnemyAlive[Slot]) {
+                          S.EnemyAlive[Slot] = false;
+                          S.State.ActiveEnemyNum--;
+                      }
+                  }
+              }));
+    TestFalse(TEXT("Alive count off from the alive flags"),
+              LoadTampered([](FInvadersSim& S) { S.State.ActiveEnemyNum++; }));
+
+    TestTrue(TEXT("Valid snapshot loads after rejected ones"),
+             Loader.LoadSnapshot(Valid));
+    return true;
+}
+
+/// TIMERS ///
+
+// Pops every timer due by Now
+static TArray<EInvadersTimer> PopAllDue(FInvadersTimerQueue& Queue,
+                                        double Now) {
+    TArray<EInvadersTimer> Popped;
+    EInvadersTimer Timer;
+    while (Queue.PopDue(Now, Timer)) {
+        Popped.Add(Timer);
+    }
+    return Popped;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInvadersTimerQueueTest,
+                                 "Invaders.Timers.Queue",
+                                 EAutomationTestFlags::ApplicationContextMask |
+                                     EAutomationTestFlags::EngineFilter)
+
+bool FInvadersTimerQueueTest::RunTest(const FString& Parameters) {
+    using T = EInvadersTimer;
+    FInvadersTimerQueue Queue;
+
+    Queue.Set(T::SpawnUfo, 3.0);
+    Queue.Set(T::SpawnPlayer, 1.0);
+    Queue.Set(T::EnemyShoot, 2.0);
+    EInvadersTimer Timer;
+    TestFalse(TEXT("Nothing due early"), Queue.PopDue(0.5, Timer));
+    TestTrue(TEXT("Due by time, earliest first"),
+             PopAllDue(Queue, 2.5) ==
+                 TArray<EInvadersTimer>({T::SpawnPlayer, T::EnemyShoot}));
+    TestTrue(TEXT("Later timer left"),
+             PopAllDue(Queue, 10.0) == TArray<EInvadersTimer>({T::SpawnUfo}));
+
+    Queue.Set(T::SpawnUfo, 1.0);
+    Queue.Set(T::SpawnPlayer, 1.0);
+    Queue.Set(T::EnemyShoot, 1.0);
+    TestTrue(TEXT("Equal times in set order"),
+             PopAllDue(Queue, 1.0) ==
+                 TArray<EInvadersTimer>(
+                     {T::SpawnUfo, T::SpawnPlayer, T::EnemyShoot}));
+
+    Queue.Set(T::SpawnUfo, 1.0);
+    Queue.Set(T::SpawnPlayer, 1.0);
+    Queue.Set(T::SpawnUfo, 1.0);
+    TestTrue(TEXT("Set again moves behind equal times"),
+             PopAllDue(Queue, 1.0) ==
+                 TArray<EInvadersTimer>({T::SpawnPlayer, T::SpawnUfo}));
+
+    Queue.Set(T::PlayerShoot, 5.0);
+    Queue.Set(T::PlayerShoot, 1.0);
+    TestTrue(TEXT("Set replaces the pending timer"),
+             PopAllDue(Queue, 10.0) ==
+                 TArray<EInvadersTimer>({T::PlayerShoot}));
+
+    Queue.Set(T::SpawnEnemies, 1.0);
+    Queue.Set(T::EnemyShoot, 2.0);
+    Queue.Clear(T::SpawnEnemies);
+    TestFalse(TEXT("Cleared timer inactive"), Queue.IsActive(T::SpawnEnemies));
+    TestTrue(TEXT("Other timer active"), Queue.IsActive(T::EnemyShoot));
+    TestTrue(TEXT("Cleared timer never fires"),
+             PopAllDue(Queue, 10.0) == TArray<EInvadersTimer>({T::EnemyShoot}));
+    Queue.Clear(T::EnemyShoot);
+    TestFalse(TEXT("Clearing an inactive timer is a no-op"),
+              Queue.IsActive(T::EnemyShoot));
+    return true;
+}
+
+struct FTestTimerEntry {
+    double Time;
+    uint32 Order;
+    uint8 Timer;
+};
+
+// Queue in the archive layout, with any count and entries
+static TArray<uint8> WriteTimerQueue(int32 Num,
+                                     TArray<FTestTimerEntry> Entries) {
+    TArray<uint8> Data;
+    FMemoryWriter Writer(Data);
+    uint32 NextOrder = Entries.Num();
+    Writer << NextOrder << Num;
+    for (FTestTimerEntry& Entry : Entries) {
+        Writer << Entry.Time << Entry.Order << Entry.Timer;
+    }
+    return Data;
+}
+
+static bool LoadTimerQueue(const TArray<uint8>& Data,
+                           FInvadersTimerQueue& Queue) {
+    FMemoryReader Reader(Data);
+    Reader << Queue;
+    return !Reader.IsError();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInvadersTimerQueueLoadTest,
+                                 "Invaders.Timers.Load",
+                                 EAutomationTestFlags::ApplicationContextMask |
+                                     EAutomationTestFlags::EngineFilter)
+
+bool FInvadersTimerQueueLoadTest::RunTest(const FString& Parameters) {
+    using T = EInvadersTimer;
+    const uint8 Ufo = uint8(T::SpawnUfo);
+    const uint8 Player = uint8(T::SpawnPlayer);
+    const uint8 Shoot = uint8(T::EnemyShoot);
+
+    FInvadersTimerQueue Saved;
+    Saved.Set(T::SpawnUfo, 3.0);
+    Saved.Set(T::SpawnPlayer, 1.0);
+    Saved.Set(T::EnemyShoot, 1.0);
+    TArray<uint8> Data;
+    FMemoryWriter Writer(Data);
+    Writer << Saved;
+    FInvadersTimerQueue Loaded;
+    TestTrue(TEXT("Saved queue loads"), LoadTimerQueue(Data, Loaded));
+    TestTrue(TEXT("Loaded queue pops like the saved one"),
+             PopAllDue(Loaded, 10.0) == PopAllDue(Saved, 10.0));
+
+    TArray<FTestTimerEntry> AllTypes;
+    for (int Timer = 0; Timer <= int(T::Num); Timer++) {
+        AllTypes.Add({1.0, uint32(Timer), uint8(Timer % int(T::Num))});
+    }
+    TestFalse(TEXT("More timers than types"),
+              LoadTimerQueue(WriteTimerQueue(AllTypes.Num(), AllTypes),
+                             Loaded));
+    TestFalse(TEXT("Negative count"),
+              LoadTimerQueue(WriteTimerQueue(-1, {}), Loaded));
+    TestFalse(TEXT("Count past the entries"),
+              LoadTimerQueue(WriteTimerQueue(2, {{1.0, 0, Ufo}}), Loaded));
+    TestFalse(TEXT("Unknown type"),
+              LoadTimerQueue(WriteTimerQueue(1, {{1.0, 0, uint8(T::Num)}}),
+                             Loaded));
+    TestFalse(TEXT("Type listed twice"),
+              LoadTimerQueue(
+                  WriteTimerQueue(2, {{1.0, 0, Ufo}, {2.0, 1, Ufo}}), Loaded));
+
+    // Latest first, the reverse of heap order
+    TestTrue(TEXT("Unordered queue loads"),
+             LoadTimerQueue(WriteTimerQueue(3, {{3.0, 2, Shoot},
+                                                {2.0, 1, Player},
+                                                {1.0, 0, Ufo}}),
+                            Loaded));
+    TestTrue(TEXT("Unordered queue pops in time order"),
+             PopAllDue(Loaded, 10.0) ==
+                 TArray<EInvadersTimer>(
+                     {T::SpawnUfo, T::SpawnPlayer, T::EnemyShoot}));
+    return true;
+}
+
+/// BATCH ///
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInvadersSimBatchTest,
+                                 "Invaders.Sim.BatchMatchesLoneGames",
+                                 EAutomationTestFlags::ApplicationContextMask |
+                                     EAutomationTestFlags::EngineFilter)
+
+bool FInvadersSimBatchTest::RunTest(const FString& Parameters) {
+    // Not a whole number of vectors, so the last one has padding lanes
+    const int Games = 6;
+    FInvadersSimBatch Batch;
+    Batch.MaxGameSteps = 120 * 5;
+    Batch.Init(MakeHitConfig(), Games);
+    Batch.Reset();
+
+    TArray<FInvadersSim> Lones;
+    Lones.SetNum(Games);
+    TArray<FInvadersSweepInput> Sources;
+    Sources.SetNum(Games);
+    for (int Game = 0; Game < Games; Game++) {
+        Lones[Game].Init(Batch.GetGame(Game).Config);
+        Lones[Game].Restart();
+    }
+
+    TArray<FInvadersInput> Inputs;
+    Inputs.SetNum(Games);
+    TArray<uint8> LoneSnapshot;
+    TArray<uint8> BatchSnapshot;
+    int Restarts = 0;
+    for (int Step = 0; Step < 120 * 12; Step++) {
+        for (int Game = 0; Game < Games; Game++) {
+            Inputs[Game] =
+                MakeSimInput(Sources[Game].MakeInput(Batch.GetGame(Game)));
+            // The batch restarts a done game at the start of the next step
+            if (Batch.GetDones()[Game]) {
+                Lones[Game].Restart();
+                Restarts++;
+            }
+            Lones[Game].Step(TestStepTime, Inputs[Game]);
+        }
+        Batch.Step(TestStepTime, Inputs);
+
+        for (int Game = 0; Game < Games; Game++) {
+            Lones[Game].SaveSnapshot(LoneSnapshot);
+            Batch.GetGame(Game).SaveSnapshot(BatchSnapshot);
+            if (LoneSnapshot != BatchSnapshot) {
+                AddError(FString::Printf(
+                    TEXT("Batched game %d left its lone game at step %d"),
+                    Game, Step));
+                return false;
+            }
+        }
+    }
+    TestTrue(TEXT("Every game restarted"), Restarts >= Games);
+    return true;
+}
+
+/// REPLAYS ///
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInvadersReplayRoundTripTest,
+                                 "Invaders.Replay.RoundTrip",
+                                 EAutomationTestFlags::ApplicationContextMask |
+                                     EAutomationTestFlags::EngineFilter)
+
+bool FInvadersReplayRoundTripTest::RunTest(const FString& Parameters) {
+    const FString Path =
+        FPaths::AutomationTransientDir() / TEXT("RoundTrip.invreplay");
+    FInvadersSimConfig Config = MakeHitConfig();
+    Config.Seed = 1234;
+
+    // Recorded like the game mode does, seeded before the restart draws
+    FInvadersSim Recorded;
+    Recorded.Init(Config);
+    FInvadersReplayHeader Header;
+    Header.Seed = Recorded.Random.GetCurrentSeed();
+    Header.SimRate = 1.f / TestStepTime;
+    FInvadersReplayWriter Writer;
+    if (!TestTrue(TEXT("Replay opens for writing"),
+                  Writer.Open(Path, Header))) {
+        return false;
+    }
+    Recorded.Restart();
+    FInvadersBotInput Bot(TestStepTime);
+    int RecordedSteps = 0;
+    while (RecordedSteps < 120 * 60 && Recorded.State.CurrentLives > 0) {
+        FInvadersInputFrame Frame = Bot.MakeInput(Recorded);
+        Writer.Write(Frame);
+        Recorded.Step(TestStepTime, MakeSimInput(Frame));
+        RecordedSteps++;
+    }
+    Writer.Close();
+
+    FInvadersReplayReader Reader;
+    FInvadersReplayHeader ReadHeader;
+    if (!TestTrue(TEXT("Replay opens for reading"),
+                  Reader.Open(Path, ReadHeader))) {
+        return false;
+    }
+    TestEqual(TEXT("Replay seed"), ReadHeader.Seed, Header.Seed);
+    TestEqual(TEXT("Replay step rate"), ReadHeader.SimRate, Header.SimRate);
+
+    FInvadersSim Replayed;
+    Replayed.Init(Config);
+    Replayed.Random.Initialize(ReadHeader.Seed);
+    Replayed.Restart();
+    int ReplayedSteps = 0;
+    FInvadersInputFrame Frame;
+    while (Reader.Read(Frame)) {
+        Replayed.Step(1.f / ReadHeader.SimRate, MakeSimInput(Frame));
+        ReplayedSteps++;
+    }
+    Reader.Close();
+    IFileManager::Get().Delete(*Path);
+
+    TestEqual(TEXT("Replayed steps"), ReplayedSteps, RecordedSteps);
+    TArray<uint8> RecordedSnapshot;
+    TArray<uint8> ReplayedSnapshot;
+    Recorded.SaveSnapshot(RecordedSnapshot);
+    Replayed.SaveSnapshot(ReplayedSnapshot);
+    TestTrue(TEXT("Replay ends in the recorded state"),
+             ReplayedSnapshot == RecordedSnapshot);
+    return true;
+}
+
+/// FORMATION ///
+
+// Formation speed factor staged for the given number of alive enemies
+static float GetFormationSpeed(FInvadersSim& Sim, int Alive) {
+    Sim.State.ActiveEnemyNum = Alive;
+    Sim.Step(0.f, FInvadersInput());
+    return Sim.Lanes->EnemySpeed[Sim.Lane];
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInvadersSimFormationSpeedTest,
+                                 "Invaders.Sim.FormationSpeed",
+                                 EAutomationTestFlags::ApplicationContextMask |
+                                     EAutomationTestFlags::EngineFilter)
+
+bool FInvadersSimFormationSpeedTest::RunTest(const FString& Parameters) {
+    // The shipped 10 by 5 formation, speeding up every ten kills
+    FInvadersSim Sim;
+    Sim.Init(FInvadersSimConfig());
+    const TPair<int, float> Speeds[] = {
+        {50, 0.25f}, {45, 0.25f}, {44, 0.3f}, {35, 0.3f},
+        {34, 0.45f}, {25, 0.45f}, {24, 0.7f}, {15, 0.7f},
+        {14, 1.05f}, {5, 1.05f},  {4, 1.5f},  {1, 1.5f},
+    };
+    for (const TPair<int, float>& Speed : Speeds) {
+        TestEqual(FString::Printf(TEXT("Speed with %d alive"), Speed.Key),
+                  GetFormationSpeed(Sim, Speed.Key), Speed.Value);
+    }
+
+    // A larger formation speeds up by the same fractions of its size
+    FInvadersSimConfig Config;
+    Config.EnemiesInRow = 100;
+    Config.EnemiesInColumn = 40;
+    Sim.Init(Config);
+    TestEqual(TEXT("Full swarm speed"), GetFormationSpeed(Sim, 4000),
+              Config.MinSpeedFactor);
+    TestEqual(TEXT("Swarm speed with a tenth alive"),
+              GetFormationSpeed(Sim, 400), 1.05f);
+    return true;
+}
+
+/// HITS ///
+
+// Formation spawned at the start of its movement, away from the asteroids
+// and the player
+static void SpawnFormation(FInvadersSim& Sim) {
+    Sim.Init(MakeHitConfig());
+    Sim.SpawnEnemies();
+}
+
+// Kills the enemy in the slot the way a player bullet does
+static bool KillEnemy(FInvadersSim& Sim, int Slot) {
+    Sim.PlayerBullets.Reset();
+    Sim.PlayerBullets.Add(Sim.GetEnemyPos(Slot), 0.f,
+                          MakeEntityId(EInvadersUnit::Player, 0, 0));
+    return Sim.ResolvePlayerBulletHit(0, EInvadersUnit::Enemy, Slot);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInvadersSimFormationHitTest,
+                                 "Invaders.Sim.Hits.Formation",
+                                 EAutomationTestFlags::ApplicationContextMask |
+                                     EAutomationTestFlags::EngineFilter)
+
+bool FInvadersSimFormationHitTest::RunTest(const FString& Parameters) {
+    FInvadersSim Sim;
+    SpawnFormation(Sim);
+    const int InRow = Sim.Config.EnemiesInRow;
+    const int LastRow = Sim.State.TotalEnemyNum - InRow;
+
+    // Cells are 25 apart and hit within 12 of their centre, the enemy
+    // extent plus the bullet's, which leaves a gap between neighbours
+    const int Slot = InRow + 3;
+    const FVector2D Pos = Sim.GetEnemyPos(Slot);
+    TestEqual(TEXT("Centre"), Sim.FindFormationHit(Pos), Slot);
+    TestEqual(TEXT("Inside the side edge"),
+              Sim.FindFormationHit(Pos + FVector2D(11.9, 0)), Slot);
+    TestEqual(TEXT("Inside the back edge"),
+              Sim.FindFormationHit(Pos + FVector2D(0, -11.9)), Slot);
+    TestEqual(TEXT("Gap beside the cell"),
+              Sim.FindFormationHit(Pos + FVector2D(12.3, 0)), INDEX_NONE);
+    TestEqual(TEXT("Gap in front of the cell"),
+              Sim.FindFormationHit(Pos + FVector2D(0, 12.3)), INDEX_NONE);
+    TestEqual(TEXT("Next column past the gap"),
+              Sim.FindFormationHit(Pos + FVector2D(13.1, 0)), Slot + 1);
+    TestEqual(TEXT("Row in front past the gap"),
+              Sim.FindFormationHit(Pos + FVector2D(0, 13.1)), Slot - InRow);
+    TestEqual(TEXT("Left of the formation"),
+              Sim.FindFormationHit(Sim.GetEnemyPos(0) - FVector2D(13.1, 0)),
+              INDEX_NONE);
+    TestEqual(
+        TEXT("Behind the formation"),
+        Sim.FindFormationHit(Sim.GetEnemyPos(LastRow) - FVector2D(0, 13.1)),
+        INDEX_NONE);
+
+    TestTrue(TEXT("Alive enemy killed"), KillEnemy(Sim, Slot));
+    TestFalse(TEXT("Dead enemy not hit again"), KillEnemy(Sim, Slot));
+    TestEqual(TEXT("Dead cell"), Sim.FindFormationHit(Pos), INDEX_NONE);
+    int UnitIdx = INDEX_NONE;
+    TestTrue(TEXT("Dead cell has no target"),
+             Sim.FindPlayerBulletTarget(Pos, UnitIdx) == EInvadersUnit::None);
+    TestTrue(TEXT("Enemy behind the dead cell"),
+             Sim.FindPlayerBulletTarget(Sim.GetEnemyPos(Slot + InRow),
+                                        UnitIdx) == EInvadersUnit::Enemy);
+    TestEqual(TEXT("Slot behind the dead cell"), UnitIdx, Slot + InRow);
+
+    TestTrue(TEXT("Asteroid"),
+             Sim.FindPlayerBulletTarget(Sim.AsteroidPositions[1], UnitIdx) ==
+                 EInvadersUnit::Asteroid);
+    TestEqual(TEXT("Asteroid index"), UnitIdx, 1);
+    Sim.SpawnUfo();
+    TestTrue(TEXT("Ufo"), Sim.FindPlayerBulletTarget(Sim.GetUfoPos(),
+                                                     UnitIdx) ==
+                              EInvadersUnit::Ufo);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInvadersSimShootersTest,
+                                 "Invaders.Sim.Hits.FrontShooters",
+                                 EAutomationTestFlags::ApplicationContextMask |
+                                     EAutomationTestFlags::EngineFilter)
+
+bool FInvadersSimShootersTest::RunTest(const FString& Parameters) {
+    FInvadersSim Sim;
+    SpawnFormation(Sim);
+    const int InRow = Sim.Config.EnemiesInRow;
+    const int Column = 3;
+    // Slots of the column, front to back
+    auto ColumnSlot = [&](int Row) { return Row * InRow + Column; };
+
+    TestEqual(TEXT("Front row shoots"), Sim.ColumnFront[Column], Column);
+    TestEqual(TEXT("Every column shoots"), Sim.ShootingColumns.Num(), InRow);
+
+    KillEnemy(Sim, ColumnSlot(0));
+    TestEqual(TEXT("Front killed, next one shoots"), Sim.ColumnFront[Column],
+              ColumnSlot(1));
+    TestEqual(TEXT("New front has nothing in front"),
+              Sim.PrevInColumn[ColumnSlot(1)], INDEX_NONE);
+
+    KillEnemy(Sim, ColumnSlot(2));
+    TestEqual(TEXT("Middle killed, front kept"), Sim.ColumnFront[Column],
+              ColumnSlot(1));
+    TestEqual(TEXT("Middle unlinked going back"),
+              Sim.NextInColumn[ColumnSlot(1)], ColumnSlot(3));
+    TestEqual(TEXT("Middle unlinked going forward"),
+              Sim.PrevInColumn[ColumnSlot(3)], ColumnSlot(1));
+
+    KillEnemy(Sim, ColumnSlot(1));
+    TestEqual(TEXT("Front after the gap"), Sim.ColumnFront[Column],
+              ColumnSlot(3));
+    TestEqual(TEXT("Column still shoots"), Sim.ShootingColumns.Num(), InRow);
+
+    for (int Row = 3; Row < Sim.Config.EnemiesInColumn; Row++) {
+        KillEnemy(Sim, ColumnSlot(Row));
+    }
+    TestEqual(TEXT("Emptied column has no front"), Sim.ColumnFront[Column],
+              INDEX_NONE);
+    TestFalse(TEXT("Emptied column unlisted"),
+              Sim.ShootingColumns.Contains(Column));
+    TestEqual(TEXT("Emptied column position"), Sim.ShootingColumnPos[Column],
+              INDEX_NONE);
+    TestEqual(TEXT("Other columns shoot"), Sim.ShootingColumns.Num(),
+              InRow - 1);
+    for (int Pos = 0; Pos < Sim.ShootingColumns.Num(); Pos++) {
+        TestEqual(TEXT("Listed column position"),
+                  Sim.ShootingColumnPos[Sim.ShootingColumns[Pos]], Pos);
+    }
+
+    // Shots only come from the front of the columns still listed
+    while (Sim.EnemyBullets.Num < Sim.EnemyBullets.Capacity) {
+        Sim.EmitEnemyBullet();
+    }
+    for (int Idx = 0; Idx < Sim.EnemyBullets.Num; Idx++) {
+        const int Slot = GetEntitySlot(Sim.EnemyBullets.Owner[Idx]);
+        TestEqual(TEXT("Shooter is its column's front"),
+                  Sim.ColumnFront[Slot % InRow], Slot);
+    }
+
+    for (int Slot = 0; Slot < Sim.State.TotalEnemyNum; Slot++) {
+        KillEnemy(Sim, Slot);
+    }
+    TestEqual(TEXT("No columns left"), Sim.ShootingColumns.Num(), 0);
+    TestFalse(TEXT("Nothing left to shoot"), Sim.EmitEnemyBullet());
+    return true;
+}
+
+#endif